@@ -0,0 +1,72 @@
+// Creates and prepares as many bare SplitterEngines as a large session
+// would, then runs the first block of each, like a host recalling the
+// session. Only the engines are measured: a plugin instance also holds a
+// second engine for morphs, its parameters, programs and band chains.
+//
+// make EngineBenchmark &&
+//     ./BandSplitter/Builds/Library/EngineStartupBenchmark [count]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "SplitterEngine.hpp"
+
+constexpr int BLOCK_SIZE = 512;
+
+// Resident memory in kB, 0 where /proc isn't available
+static long residentMemory() {
+    FILE* file = std::fopen("/proc/self/statm", "r");
+    if (file == nullptr) return 0;
+    long size = 0, resident = 0;
+    if (std::fscanf(file, "%ld %ld", &size, &resident) != 2) resident = 0;
+    std::fclose(file);
+    return resident * 4;
+}
+
+static double millisecondsSince(
+    std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+int main(int argc, char** argv) {
+    const int count = argc > 1 ? std::max(1, std::atoi(argv[1])) : 300;
+
+    std::vector<float> input(BLOCK_SIZE * MAX_CHANNELS, .1f);
+    std::vector<float> output(BLOCK_SIZE * MAX_BANDS * MAX_CHANNELS);
+    const float* inputs[MAX_CHANNELS];
+    float* outputs[MAX_BANDS * MAX_CHANNELS];
+    for (int c = 0; c < MAX_CHANNELS; c++)
+        inputs[c] = input.data() + c * BLOCK_SIZE;
+    for (int i = 0; i < MAX_BANDS * MAX_CHANNELS; i++)
+        outputs[i] = output.data() + i * BLOCK_SIZE;
+
+    const long memory = residentMemory();
+    std::vector<std::unique_ptr<SplitterEngine>> engines;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        engines.push_back(std::make_unique<SplitterEngine>());
+        engines.back()->setBands(MAX_BANDS);
+        engines.back()->prepare(48000);
+    }
+    const double prepare = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (auto& engine : engines)
+        engine->process(inputs, MAX_CHANNELS, outputs, BLOCK_SIZE);
+    const double process = millisecondsSince(start);
+
+    std::printf("%d engines of %zu bytes\n", count, sizeof(SplitterEngine));
+    std::printf("create and prepare: %.3f ms (%.1f us each)\n", prepare,
+                prepare * 1000 / count);
+    std::printf("first block: %.3f ms (%.1f us each)\n", process,
+                process * 1000 / count);
+    std::printf("resident memory: %ld kB (%ld kB each)\n",
+                residentMemory() - memory,
+                (residentMemory() - memory) / count);
+    return 0;
+}
@@ -0,0 +1,378 @@
+// Renders an impulse, a sweep and noise through the engine for every band
+// count, split type and topology, and checks each band against the response
+// the engine reports for it, the sum of the bands against its reported
+// reconstruction error and the mono renders against the stored references.
+// Stereo layouts have to give the mono render of what each channel carries.
+// Exits with 1 when any of them is off.
+//
+// make check
+//
+// After a change meant to alter the output, rewrite the references with
+// ./BandSplitter/Builds/Library/EngineTest --write
+//     BandSplitter/Benchmarks/EngineReference.bin
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "SplitterEngine.hpp"
+
+constexpr double RATE = 48000;
+// The signals fill the first half, the splits ring out in the second one
+// (under 50 ms for the lowest split) so that the spectra hold every output
+constexpr int LENGTH = 8192;
+// Uneven, the bit exact engine has to give the same output for any block
+constexpr int BLOCK = 1000;
+constexpr float LOWEST = 400, HIGHEST = 6000;
+// Enough for the highest splits to run as linear phase FIRs in MODE_FIR
+constexpr int FIR_BUDGET = 256;
+// Frequencies the responses are compared at, log spaced from 20 Hz to 20 kHz
+constexpr int POINTS = 240;
+// Samples of every band stored per render, from the start of the impulse
+// response and from the middle of the sweep and noise
+constexpr int WINDOW = 16;
+
+// Distance between the spectrum of a band and the reported response times
+// the spectrum of the input, relative to the RMS of the input spectrum. The
+// sections of the lowest splits round to about -65 dB of it.
+constexpr double RESPONSE_TOLERANCE = 2e-3;
+// Between the magnitude of the band sum and the reconstruction error, where
+// the input is within 6 dB of its RMS
+constexpr double SUM_TOLERANCE_DB = .02;
+// Outputs are bit exact on one machine, the designs go through libm
+constexpr double REFERENCE_TOLERANCE = 1e-5;
+// A stereo channel against the mono render scaled, the filters round
+// differently on the scaled input
+constexpr double LAYOUT_TOLERANCE = 1e-4;
+
+enum Mode { MODE_DIRECT, MODE_SVF, MODE_FIR };
+constexpr int MODES = 3;
+static const char* const MODE_NAMES[MODES] = {"direct", "svf", "fir"};
+
+enum Signal { SIGNAL_IMPULSE, SIGNAL_SWEEP, SIGNAL_NOISE };
+constexpr int SIGNALS = 3;
+static const char* const SIGNAL_NAMES[SIGNALS] = {"impulse", "sweep",
+                                                  "noise"};
+
+// Right channel of the stereo renders relative to the left one
+constexpr float RIGHT_LEVEL = .5f;
+
+enum Layout { LAYOUT_LR, LAYOUT_MS, LAYOUT_MONO_LOW };
+constexpr int LAYOUTS = 3;
+static const char* const LAYOUT_NAMES[LAYOUTS] = {"L/R", "M/S",
+                                                  "L/R with a mono band"};
+
+using Spectrum = std::vector<std::complex<double>>;
+
+// What the engine reports at the compared bins, from its last designs
+struct Responses {
+    int bins[POINTS];
+    std::complex<double> bands[MAX_BANDS][POINTS];
+    double reconstructionErrors[POINTS];
+
+    void read(const SplitterEngine& engine) {
+        for (int p = 0; p < POINTS; p++) {
+            bins[p] = (int)std::lround(
+                20 * std::pow(1000.0, p / (POINTS - 1.0)) * LENGTH / RATE);
+            const float f = (float)(bins[p] * RATE / LENGTH);
+            for (int j = 0; j < engine.getBands(); j++)
+                bands[j][p] = engine.getBandResponse(j, f);
+            reconstructionErrors[p] = engine.getReconstructionError(f);
+        }
+    }
+};
+
+static int failures = 0;
+
+static void report(enum SplitType type, int bands, int mode,
+                   const char* what, double error) {
+    std::printf("%s, %d bands, %s: %s is off by %g\n",
+                getCrossoverDesign(type).name, bands, MODE_NAMES[mode], what,
+                error);
+    failures++;
+}
+
+static void fillSignal(int signal, float* data) {
+    std::fill(data, data + LENGTH, 0.f);
+    const int length = LENGTH / 2;
+    if (signal == SIGNAL_IMPULSE) {
+        data[0] = 1;
+    } else if (signal == SIGNAL_SWEEP) {
+        // Exponential from 20 Hz to 20 kHz, with a short fade at both ends
+        const double rate = std::log(1000.0) / length;
+        const int fade = length / 64;
+        for (int i = 0; i < length; i++) {
+            const double phase =
+                2 * M_PI * 20 / RATE * (std::exp(rate * i) - 1) / rate;
+            const double gain =
+                std::min(1.0, std::min(i, length - 1 - i) / (double)fade);
+            data[i] = (float)(.5 * gain * std::sin(phase));
+        }
+    } else {
+        unsigned int seed = 1;
+        for (int i = 0; i < length; i++) {
+            seed = seed * 1664525 + 1013904223;
+            data[i] = .5f * ((int)(seed >> 8) / 8388608.f - 1);
+        }
+    }
+}
+
+// In place radix 2 FFT, LENGTH points
+static void fft(Spectrum& x) {
+    for (int i = 1, j = 0; i < LENGTH; i++) {
+        int bit = LENGTH >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(x[i], x[j]);
+    }
+    for (int size = 2; size <= LENGTH; size <<= 1) {
+        const std::complex<double> step = std::polar(1.0, -2 * M_PI / size);
+        for (int start = 0; start < LENGTH; start += size) {
+            std::complex<double> w = 1;
+            for (int k = 0; k < size / 2; k++) {
+                const std::complex<double> a = x[start + k];
+                const std::complex<double> b = x[start + k + size / 2] * w;
+                x[start + k] = a + b;
+                x[start + k + size / 2] = a - b;
+                w *= step;
+            }
+        }
+    }
+}
+
+static Spectrum spectrum(const float* data) {
+    Spectrum x(data, data + LENGTH);
+    fft(x);
+    return x;
+}
+
+static void configure(SplitterEngine& engine, enum SplitType type, int bands,
+                      int mode) {
+    engine.prepare(RATE);
+    engine.setIdleDetection(false);
+    engine.setBitExact(true);
+    engine.setBands(bands);
+    engine.setSplitType(type);
+    for (int i = 0; i < bands - 1; i++) {
+        const double position = bands == 2 ? .5 : i / (double)(bands - 2);
+        engine.setSplitFrequency(
+            i, (float)(LOWEST * std::pow(HIGHEST / LOWEST, position)));
+        engine.setSplitTopology(
+            i, mode == MODE_SVF ? TOPOLOGY_SVF : TOPOLOGY_DIRECT);
+    }
+    engine.setFirBudget(mode == MODE_FIR ? FIR_BUDGET : 0);
+}
+
+// Renders the channels of inputs in uneven blocks into outputs, band j,
+// channel c at (j * channels + c) * LENGTH
+static void render(SplitterEngine& engine, const float* const* inputs,
+                   int channels, float* outputs) {
+    engine.reset();
+    const int bands = engine.getBands();
+    for (int start = 0; start < LENGTH; start += BLOCK) {
+        const int samples = std::min(BLOCK, LENGTH - start);
+        const float* in[MAX_CHANNELS];
+        float* out[MAX_BANDS * MAX_CHANNELS];
+        for (int c = 0; c < channels; c++) in[c] = inputs[c] + start;
+        for (int k = 0; k < bands * channels; k++)
+            out[k] = outputs + k * LENGTH + start;
+        engine.process(in, channels, out, samples);
+    }
+}
+
+// Checks the mono render of signal against the responses, writes the
+// samples of its bands to compare with the references in window
+static void testResponses(const Responses& responses, enum SplitType type,
+                          int bands, int mode, int signal,
+                          const float* input, const float* outputs,
+                          float* window) {
+    const Spectrum x = spectrum(input);
+    double energy = 0;
+    for (int i = 0; i < LENGTH; i++) energy += (double)input[i] * input[i];
+    const double rms = std::sqrt(energy);
+
+    std::vector<float> sum(LENGTH, 0.f);
+    double responseError = 0;
+    for (int j = 0; j < bands; j++) {
+        const float* band = outputs + j * LENGTH;
+        for (int i = 0; i < LENGTH; i++) sum[i] += band[i];
+        const Spectrum y = spectrum(band);
+        for (int p = 0; p < POINTS; p++) {
+            const int k = responses.bins[p];
+            responseError = std::max(
+                responseError,
+                std::abs(y[k] - responses.bands[j][p] * x[k]) / rms);
+        }
+        const int offset = signal == SIGNAL_IMPULSE ? 0 : LENGTH / 4;
+        std::memcpy(window + j * WINDOW, band + offset,
+                    WINDOW * sizeof(float));
+    }
+    char what[64];
+    if (!(responseError <= RESPONSE_TOLERANCE)) {
+        std::snprintf(what, sizeof(what), "the %s response",
+                      SIGNAL_NAMES[signal]);
+        report(type, bands, mode, what, responseError);
+    }
+
+    const Spectrum y = spectrum(sum.data());
+    double sumError = 0;
+    for (int p = 0; p < POINTS; p++) {
+        const int k = responses.bins[p];
+        if (std::abs(x[k]) < .5 * rms) continue;
+        const double level = 20 * std::log10(std::abs(y[k] / x[k]));
+        sumError = std::max(
+            sumError, std::fabs(level - responses.reconstructionErrors[p]));
+    }
+    if (!(sumError <= SUM_TOLERANCE_DB)) {
+        std::snprintf(what, sizeof(what), "the %s band sum (dB)",
+                      SIGNAL_NAMES[signal]);
+        report(type, bands, mode, what, sumError);
+    }
+}
+
+// Level of each channel of band j relative to the mono render of the left
+// input
+static void getLayoutLevels(int layout, int band, float* levels) {
+    if (layout == LAYOUT_MS) {
+        levels[0] = .5f * (1 + RIGHT_LEVEL);
+        levels[1] = .5f * (1 - RIGHT_LEVEL);
+    } else if (layout == LAYOUT_MONO_LOW && band == 0) {
+        levels[0] = levels[1] = .5f * (1 + RIGHT_LEVEL);
+    } else {
+        levels[0] = 1;
+        levels[1] = RIGHT_LEVEL;
+    }
+}
+
+// The layouts only change what goes through the splits, they are checked on
+// the noise
+static void testLayout(enum SplitType type, int bands, int mode, int layout,
+                       const float* const* inputs, const float* mono,
+                       float* outputs) {
+    SplitterEngine engine;
+    configure(engine, type, bands, mode);
+    engine.setStereoMode(layout == LAYOUT_MS ? STEREO_MS : STEREO_LR);
+    engine.setMonoBands(layout == LAYOUT_MONO_LOW ? 1 : 0);
+    render(engine, inputs, 2, outputs);
+
+    double error = 0;
+    for (int j = 0; j < bands; j++) {
+        float levels[MAX_CHANNELS];
+        getLayoutLevels(layout, j, levels);
+        for (int c = 0; c < 2; c++) {
+            const float* channel = outputs + (j * 2 + c) * LENGTH;
+            for (int i = 0; i < LENGTH; i++)
+                error = std::max(error, (double)std::fabs(
+                                            channel[i] -
+                                            levels[c] * mono[j * LENGTH + i]));
+        }
+    }
+    if (!(error <= LAYOUT_TOLERANCE)) {
+        report(type, bands, mode, LAYOUT_NAMES[layout], error);
+    }
+}
+
+// Every band of every render in the order of the loops in main
+static int getReferenceSize() {
+    int size = 0;
+    for (int bands = 2; bands <= MAX_BANDS; bands++)
+        size += SPLIT_TYPES * MODES * SIGNALS * bands * WINDOW;
+    return size;
+}
+
+int main(int argc, char** argv) {
+    const bool write = argc > 2 && std::strcmp(argv[1], "--write") == 0;
+    const char* path = argc > 1 ? argv[argc - 1] : nullptr;
+    if (path == nullptr) {
+        std::printf("usage: %s [--write] reference\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<float> references(getReferenceSize());
+    if (!write) {
+        FILE* file = std::fopen(path, "rb");
+        const bool read =
+            file != nullptr &&
+            std::fread(references.data(), sizeof(float), references.size(),
+                       file) == references.size() &&
+            std::fgetc(file) == EOF;
+        if (file != nullptr) std::fclose(file);
+        if (!read) {
+            std::printf("%s isn't a reference of this test\n", path);
+            return 1;
+        }
+    }
+
+    std::vector<float> left(LENGTH), right(LENGTH);
+    std::vector<float> mono((size_t)MAX_BANDS * LENGTH);
+    std::vector<float> stereo((size_t)MAX_BANDS * MAX_CHANNELS * LENGTH);
+    std::vector<float> window(MAX_BANDS * WINDOW);
+    const float* monoInputs[] = {left.data()};
+    const float* stereoInputs[] = {left.data(), right.data()};
+    int position = 0;
+
+    for (int t = 0; t < SPLIT_TYPES; t++) {
+        const enum SplitType type = (SplitType)t;
+        const int before = failures;
+        for (int bands = 2; bands <= MAX_BANDS; bands++) {
+            for (int mode = 0; mode < MODES; mode++) {
+                SplitterEngine engine;
+                configure(engine, type, bands, mode);
+                Responses responses;
+                for (int signal = 0; signal < SIGNALS; signal++) {
+                    fillSignal(signal, left.data());
+                    for (int i = 0; i < LENGTH; i++)
+                        right[i] = RIGHT_LEVEL * left[i];
+
+                    render(engine, monoInputs, 1, mono.data());
+                    if (signal == SIGNAL_IMPULSE) responses.read(engine);
+                    testResponses(responses, type, bands, mode, signal,
+                                  left.data(), mono.data(), window.data());
+                    for (int layout = 0;
+                         signal == SIGNAL_NOISE && layout < LAYOUTS; layout++)
+                        testLayout(type, bands, mode, layout, stereoInputs,
+                                   mono.data(), stereo.data());
+
+                    float* reference = references.data() + position;
+                    position += bands * WINDOW;
+                    if (write) {
+                        std::copy(window.begin(),
+                                  window.begin() + bands * WINDOW, reference);
+                        continue;
+                    }
+                    double error = 0;
+                    for (int i = 0; i < bands * WINDOW; i++)
+                        error = std::max(error, (double)std::fabs(
+                                                    window[i] - reference[i]));
+                    if (!(error <= REFERENCE_TOLERANCE)) {
+                        char what[64];
+                        std::snprintf(what, sizeof(what),
+                                      "the %s against the reference",
+                                      SIGNAL_NAMES[signal]);
+                        report(type, bands, mode, what, error);
+                    }
+                }
+            }
+        }
+        std::printf("%s: %s\n", getCrossoverDesign(type).name,
+                    failures == before ? "ok" : "mismatch");
+    }
+
+    if (write) {
+        FILE* file = std::fopen(path, "wb");
+        const bool written =
+            file != nullptr &&
+            std::fwrite(references.data(), sizeof(float), references.size(),
+                        file) == references.size();
+        if (file != nullptr) std::fclose(file);
+        if (!written) {
+            std::printf("can't write %s\n", path);
+            return 1;
+        }
+        std::printf("wrote %s\n", path);
+    }
+    return failures == 0 ? 0 : 1;
+}
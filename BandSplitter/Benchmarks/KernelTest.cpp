@@ -0,0 +1,276 @@
+// Runs every kernel the CPU supports against the scalar reference on fixed
+// noise, over every split type, lane count and a few uneven block sizes.
+// The cascade, allpass, state variable and FIR kernels have to match it bit
+// for bit. The time-blocked ones round differently, they have to stay
+// about as close as the reference to the same filter run in double. Exits
+// with 1 when any kernel doesn't.
+//
+// make check
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "CrossoverDesign.hpp"
+#include "DspKernels.hpp"
+
+constexpr int MAX_KERNELS = 8;
+constexpr int MAX_SIZE = 257;
+constexpr std::size_t STATE_SIZE = MAX_SECTIONS * 2 + 2;
+// The blocks may be twice as far from the exact filter as the reference,
+// they also round their states to float, plus a few roundings of a full
+// scale sample
+constexpr double BLOCKS_TOLERANCE = 1e-6;
+
+static const int SIZES[] = {1, 3, 64, MAX_SIZE};
+static const float FREQUENCIES[] = {100, 1000, 10000};
+
+// One step of a direct form I section in double, z holds x1, x2, y1, y2
+static double biquad(const struct BiquadFilterCoefficients& c, double* z,
+                     double xn) {
+    const double yn =
+        c.b0 * xn + c.b1 * z[0] + c.b2 * z[1] - c.a1 * z[2] - c.a2 * z[3];
+    z[1] = z[0];
+    z[0] = xn;
+    z[3] = z[2];
+    z[2] = yn;
+    return yn;
+}
+
+// Two sets of lanes, one for the reference and one for the kernel tested,
+// filled with the same noise, and the exact output of the filter
+struct Lanes {
+    float expected[MAX_LANES][MAX_SIZE], actual[MAX_LANES][MAX_SIZE];
+    float expectedStates[MAX_LANES][STATE_SIZE],
+        actualStates[MAX_LANES][STATE_SIZE];
+    float *expectedBuffers[MAX_LANES], *actualBuffers[MAX_LANES];
+    State expectedStatePtrs[MAX_LANES], actualStatePtrs[MAX_LANES];
+    double exact[MAX_LANES][MAX_SIZE];
+    double exactStates[MAX_LANES][MAX_SECTIONS][4];
+    unsigned int seed = 1;
+
+    Lanes() {
+        for (int l = 0; l < MAX_LANES; l++) {
+            expectedBuffers[l] = expected[l];
+            actualBuffers[l] = actual[l];
+            expectedStatePtrs[l] = expectedStates[l];
+            actualStatePtrs[l] = actualStates[l];
+        }
+    }
+
+    void clearStates() {
+        std::memset(expectedStates, 0, sizeof(expectedStates));
+        std::memset(actualStates, 0, sizeof(actualStates));
+        std::memset(exactStates, 0, sizeof(exactStates));
+    }
+
+    void fill(int lanes, int size) {
+        for (int l = 0; l < lanes; l++) {
+            for (int i = 0; i < size; i++) {
+                seed = seed * 1664525 + 1013904223;
+                expected[l][i] = actual[l][i] =
+                    (int)(seed >> 8) / 8388608.f - 1;
+            }
+        }
+    }
+
+    // Runs the inputs through the cascade in double, or through both
+    // branches of an allpass split when branches isn't null. Before the
+    // reference overwrites them.
+    void runExact(const struct BiquadFilterCoefficients* coeffs,
+                  std::size_t sections,
+                  const struct BiquadFilterCoefficients* branches, float sign,
+                  int lanes, int size) {
+        for (int l = 0; l < lanes; l++) {
+            for (int i = 0; i < size; i++) {
+                double x = expected[l][i];
+                if (branches != nullptr) {
+                    x = .5 * (biquad(branches[0], exactStates[l][0], x) +
+                              sign * biquad(branches[1], exactStates[l][1], x));
+                } else {
+                    for (std::size_t j = 0; j < sections; j++)
+                        x = biquad(coeffs[j], exactStates[l][j], x);
+                }
+                exact[l][i] = x;
+            }
+        }
+    }
+
+    // Largest distance of outputs to the exact ones
+    double distance(const float (&outputs)[MAX_LANES][MAX_SIZE], int lanes,
+                    int size) const {
+        double error = 0;
+        for (int l = 0; l < lanes; l++)
+            for (int i = 0; i < size; i++)
+                error = std::max(error, std::fabs(outputs[l][i] - exact[l][i]));
+        return error;
+    }
+
+    // Largest difference of the outputs, infinite when the states differ
+    // while exact is set
+    float compare(int lanes, int size, bool exact) const {
+        float error = 0;
+        for (int l = 0; l < lanes; l++) {
+            if (exact && std::memcmp(expectedStates[l], actualStates[l],
+                                     sizeof(expectedStates[l])) != 0)
+                return INFINITY;
+            for (int i = 0; i < size; i++)
+                error =
+                    std::max(error, std::fabs(expected[l][i] - actual[l][i]));
+        }
+        return error;
+    }
+};
+
+static Lanes lanes;
+static int failures = 0;
+
+static void report(const struct DspKernel& kernel, const char* what,
+                   enum SplitType type, float f, int count, int size,
+                   double error) {
+    std::printf("%s: %s of %s at %g Hz on %d lanes of %d samples is off by "
+                "%g\n",
+                kernel.name, what, getCrossoverDesign(type).name, f, count,
+                size, error);
+    failures++;
+}
+
+// Runs two blocks through the kernel and the reference so that the states
+// carried over are checked too
+static void testCascade(const struct DspKernel& kernel,
+                        const struct DspKernel& reference, enum SplitType type,
+                        float f) {
+    struct BiquadFilterCoefficients lp[MAX_SECTIONS], hp[MAX_SECTIONS],
+        branches[2];
+    const std::size_t sections = designSplit(type, f, 48000, lp, hp, branches);
+    const bool allpass = getCrossoverDesign(type).allpass;
+
+    for (int count = 1; count <= MAX_LANES; count++) {
+        for (int size : SIZES) {
+            for (int side = 0; side < 2; side++) {
+                const struct BiquadFilterCoefficients* coeffs =
+                    side == 0 ? lp : hp;
+                const float sign = side == 0 ? 1 : -1;
+                for (int blocks = 0; blocks < 2; blocks++) {
+                    lanes.clearStates();
+                    // The reference's distance to the exact filter, then
+                    // the kernel's
+                    double error = 0, referenceError = 0, kernelError = 0;
+                    for (int block = 0; block < 2; block++) {
+                        lanes.fill(count, size);
+                        lanes.runExact(coeffs, sections,
+                                       allpass ? branches : nullptr, sign,
+                                       count, size);
+                        if (allpass) {
+                            reference.allpass(branches, sign,
+                                              lanes.expectedBuffers,
+                                              lanes.expectedStatePtrs, count,
+                                              size);
+                            (blocks ? kernel.allpassBlocks : kernel.allpass)(
+                                branches, sign, lanes.actualBuffers,
+                                lanes.actualStatePtrs, count, size);
+                        } else {
+                            reference.cascade(coeffs, sections,
+                                              lanes.expectedBuffers,
+                                              lanes.expectedStatePtrs, count,
+                                              size);
+                            (blocks ? kernel.blocks : kernel.cascade)(
+                                coeffs, sections, lanes.actualBuffers,
+                                lanes.actualStatePtrs, count, size);
+                        }
+                        error = std::max(
+                            error, (double)lanes.compare(count, size, !blocks));
+                        referenceError = std::max(
+                            referenceError,
+                            lanes.distance(lanes.expected, count, size));
+                        kernelError = std::max(
+                            kernelError,
+                            lanes.distance(lanes.actual, count, size));
+                    }
+                    const char* what =
+                        allpass ? (blocks ? "allpassBlocks" : "allpass")
+                                : (blocks ? "blocks" : "cascade");
+                    if (blocks ? !(kernelError <=
+                                   2 * referenceError + BLOCKS_TOLERANCE)
+                               : error != 0)
+                        report(kernel, what, type, f, count, size,
+                               blocks ? kernelError : error);
+                }
+            }
+        }
+    }
+}
+
+static void testSvf(const struct DspKernel& kernel,
+                    const struct DspKernel& reference, enum SplitType type,
+                    float f) {
+    struct SvfCoefficients lp[MAX_SECTIONS], hp[MAX_SECTIONS];
+    const std::size_t sections = designSplitSvf(type, f, 48000, lp, hp);
+
+    for (int count = 1; count <= MAX_LANES; count++) {
+        for (int size : SIZES) {
+            for (int side = 0; side < 2; side++) {
+                const struct SvfCoefficients* coeffs = side == 0 ? lp : hp;
+                lanes.clearStates();
+                float error = 0;
+                for (int block = 0; block < 2; block++) {
+                    lanes.fill(count, size);
+                    reference.svf(coeffs, sections, lanes.expectedBuffers,
+                                  lanes.expectedStatePtrs, count, size);
+                    kernel.svf(coeffs, sections, lanes.actualBuffers,
+                               lanes.actualStatePtrs, count, size);
+                    error = std::max(error, lanes.compare(count, size, true));
+                }
+                if (error != 0)
+                    report(kernel, "svf", type, f, count, size, error);
+            }
+        }
+    }
+}
+
+// Every length the linear phase splits can take
+static void testFir(const struct DspKernel& kernel,
+                    const struct DspKernel& reference) {
+    static float input[MAX_FIR_TAPS - 1 + MAX_SIZE];
+    float taps[MAX_FIR_TAPS], expected[MAX_SIZE], actual[MAX_SIZE];
+    for (int length = MIN_FIR_TAPS; length <= MAX_FIR_TAPS;
+         length = length * 2 + 1) {
+        designFirSplit(3000, 48000, taps, length);
+        for (int size : SIZES) {
+            lanes.fill(1, MAX_SIZE);
+            for (int i = 0; i < length - 1 + size; i++)
+                input[i] = lanes.expected[0][i % MAX_SIZE];
+            reference.fir(taps, length, input, expected, size);
+            kernel.fir(taps, length, input, actual, size);
+            if (std::memcmp(expected, actual, size * sizeof(float)) != 0) {
+                std::printf("%s: fir of %d taps on %d samples differs\n",
+                            kernel.name, length, size);
+                failures++;
+            }
+        }
+    }
+}
+
+int main() {
+    const struct DspKernel* kernels[MAX_KERNELS];
+    const int count =
+        std::min(getSupportedDspKernels(kernels, MAX_KERNELS), MAX_KERNELS);
+    const struct DspKernel& reference = getReferenceDspKernel();
+
+    for (int k = 0; k < count; k++) {
+        const struct DspKernel& kernel = *kernels[k];
+        const int before = failures;
+        for (int t = 0; t < SPLIT_TYPES; t++) {
+            for (float f : FREQUENCIES) {
+                testCascade(kernel, reference, (SplitType)t, f);
+                testSvf(kernel, reference, (SplitType)t, f);
+            }
+        }
+        testFir(kernel, reference);
+        std::printf("%s: %s\n", kernel.name,
+                    failures == before ? "ok" : "mismatch");
+    }
+    std::printf("selected: %s\n", getDspKernel().name);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,256 @@
+// Runs many engines the way a host runs a large session: every block of
+// the audio device, a pool of threads goes through all of them before the
+// deadline. Split frequencies and band counts are automated at random. Prints
+// the CPU used, the blocks that missed their deadline and, where
+// perf_event_open is allowed, the cache misses. Exits with 1 when a block
+// missed its deadline.
+//
+// make SessionBenchmark && ./BandSplitter/Builds/Library/SessionBenchmark
+//     [instances] [threads] [block size] [seconds]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "SplitterEngine.hpp"
+
+constexpr double SAMPLE_RATE = 48000;
+// Chances, per block and instance, that a split frequency moves and that
+// the band count changes
+constexpr double SPLIT_AUTOMATION = .2;
+constexpr double BANDS_AUTOMATION = .001;
+
+// One track of the session with its own buffers and automation
+struct Instance {
+    SplitterEngine engine;
+    std::vector<float> input, output;
+    std::minstd_rand random;
+    float frequencies[MAX_BANDS - 1];
+};
+
+// Hardware counter of every thread the process starts after it is opened
+class PerfCounter {
+   public:
+    PerfCounter(unsigned int type, unsigned long long config) {
+#ifdef __linux__
+        perf_event_attr attr = {};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+        (void)type;
+        (void)config;
+#endif
+    }
+    ~PerfCounter() {
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    inline bool isAvailable() const { return fd >= 0; }
+    void start() {
+#ifdef __linux__
+        if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+    // Count of the threads that have ended, -1 without the counter
+    long long stop() {
+        long long count = -1;
+#ifdef __linux__
+        if (fd < 0) return -1;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) != sizeof(count)) count = -1;
+#endif
+        return count;
+    }
+
+   private:
+    int fd = -1;
+};
+
+static double cpuSeconds() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+// What the processor does with its parameters before every block
+static void automate(Instance& instance) {
+    std::uniform_real_distribution<double> chance(0, 1);
+    if (chance(instance.random) < BANDS_AUTOMATION) {
+        std::uniform_int_distribution<int> bands(2, MAX_BANDS);
+        instance.engine.setBands(bands(instance.random));
+    }
+    if (chance(instance.random) < SPLIT_AUTOMATION) {
+        std::uniform_int_distribution<int> split(0, MAX_BANDS - 2);
+        std::uniform_real_distribution<float> move(.97f, 1.03f);
+        float& f = instance.frequencies[split(instance.random)];
+        f = std::clamp(f * move(instance.random), 20.f, 20000.f);
+    }
+    for (int i = 0; i < MAX_BANDS - 1; i++)
+        instance.engine.setSplitFrequency(i, instance.frequencies[i]);
+}
+
+int main(int argc, char** argv) {
+    const int count = argc > 1 ? std::max(1, std::atoi(argv[1])) : 300;
+    const int threads =
+        argc > 2 ? std::max(1, std::atoi(argv[2]))
+                 : std::max(1, (int)std::thread::hardware_concurrency());
+    const int blockSize = argc > 3 ? std::max(16, std::atoi(argv[3])) : 256;
+    const double seconds = argc > 4 ? std::atof(argv[4]) : 10;
+
+    // Tracks of a session differ in their settings and their audio
+    std::vector<std::unique_ptr<Instance>> instances;
+    std::normal_distribution<float> noise(0, .1f);
+    for (int k = 0; k < count; k++) {
+        auto instance = std::make_unique<Instance>();
+        instance->random.seed(k + 1);
+        instance->input.resize((size_t)blockSize * MAX_CHANNELS);
+        for (float& x : instance->input) x = noise(instance->random);
+        instance->output.resize((size_t)blockSize * MAX_BANDS * MAX_CHANNELS);
+        std::copy(DEFAULT_SPLIT_FREQUENCIES,
+                  DEFAULT_SPLIT_FREQUENCIES + MAX_BANDS - 1,
+                  instance->frequencies);
+        instance->engine.setSplitType((SplitType)(k % SPLIT_TYPES));
+        instance->engine.setBands(2 + k % (MAX_BANDS - 1));
+        instance->engine.prepare(SAMPLE_RATE);
+        instances.push_back(std::move(instance));
+    }
+
+    // The host graph, every cycle the threads take the instances one after
+    // the other until none is left
+    std::atomic<int> cycle{0}, next{0}, done{0};
+    std::atomic<bool> running{true};
+    auto processNext = [&]() {
+        const int k = next.fetch_add(1);
+        if (k >= count) return false;
+        Instance& instance = *instances[k];
+        const float* inputs[MAX_CHANNELS];
+        float* outputs[MAX_BANDS * MAX_CHANNELS];
+        for (int c = 0; c < MAX_CHANNELS; c++)
+            inputs[c] = instance.input.data() + c * blockSize;
+        for (int i = 0; i < MAX_BANDS * MAX_CHANNELS; i++)
+            outputs[i] = instance.output.data() + i * blockSize;
+        automate(instance);
+        instance.engine.process(inputs, MAX_CHANNELS, outputs, blockSize);
+        done.fetch_add(1, std::memory_order_release);
+        return true;
+    };
+
+    PerfCounter misses(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    PerfCounter references(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES);
+    PerfCounter llcMisses(PERF_TYPE_HW_CACHE,
+                          PERF_COUNT_HW_CACHE_LL |
+                              (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    misses.start();
+    references.start();
+    llcMisses.start();
+
+    // The calling thread is the host's audio thread and works too
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; t++) {
+        workers.emplace_back([&]() {
+            int seen = 0;
+            while (running.load(std::memory_order_acquire)) {
+                const int c = cycle.load(std::memory_order_acquire);
+                if (c == seen) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                seen = c;
+                while (processNext()) {
+                }
+            }
+        });
+    }
+
+    using Clock = std::chrono::steady_clock;
+    const auto deadline = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(blockSize / SAMPLE_RATE));
+    const int cycles = std::max(1, (int)(seconds * SAMPLE_RATE / blockSize));
+    std::vector<double> times;
+    times.reserve(cycles);
+    int missed = 0;
+
+    const double cpuStart = cpuSeconds();
+    const auto start = Clock::now();
+    auto due = start;
+    for (int n = 0; n < cycles; n++) {
+        // The device asks for the next block one period after the last
+        std::this_thread::sleep_until(due);
+        const auto begin = Clock::now();
+        done.store(0, std::memory_order_relaxed);
+        // Workers that see the new index see the count cleared too
+        next.store(0, std::memory_order_release);
+        cycle.fetch_add(1, std::memory_order_release);
+        while (processNext()) {
+        }
+        while (done.load(std::memory_order_acquire) < count)
+            std::this_thread::yield();
+        const auto end = Clock::now();
+
+        times.push_back(std::chrono::duration<double, std::milli>(end - begin)
+                            .count());
+        if (end - begin > deadline) missed++;
+        due += deadline;
+        // A late cycle pushes the next ones back, as a device would drop out
+        if (due < end) due = end;
+    }
+    const double wall =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    const double cpu = cpuSeconds() - cpuStart;
+
+    running.store(false, std::memory_order_release);
+    for (std::thread& worker : workers) worker.join();
+    const long long missCount = misses.stop();
+    const long long referenceCount = references.stop();
+    const long long llcMissCount = llcMisses.stop();
+
+    std::sort(times.begin(), times.end());
+    const double period = blockSize * 1000 / SAMPLE_RATE;
+    std::printf("%d instances, %d threads, %d samples (%.2f ms) per block\n",
+                count, threads, blockSize, period);
+    std::printf("cycles: %d, missed deadlines: %d (%.2f%%)\n", cycles, missed,
+                100. * missed / cycles);
+    std::printf("cycle time: median %.3f ms, 99%% %.3f ms, max %.3f ms\n",
+                times[times.size() / 2], times[times.size() * 99 / 100],
+                times.back());
+    std::printf("cpu: %.2f s over %.2f s (%.2f cores, %.1f us per block "
+                "and instance)\n",
+                cpu, wall, cpu / wall, cpu * 1e6 / ((double)cycles * count));
+    // Workers spin between cycles, the cpu time includes their waits
+    if (missCount >= 0 && referenceCount > 0)
+        std::printf("cache misses: %lld of %lld references (%.2f%%), %.1f "
+                    "per block and instance\n",
+                    missCount, referenceCount,
+                    100. * missCount / referenceCount,
+                    (double)missCount / ((double)cycles * count));
+    else
+        std::printf("cache misses: perf_event_open unavailable\n");
+    if (llcMissCount >= 0)
+        std::printf("last level cache read misses: %lld\n", llcMissCount);
+    return missed > 0;
+}
@@ -0,0 +1,331 @@
+#include "BandChains.hpp"
+
+#include <cstring>
+#include <thread>
+
+// Ring size of the delay lines, a power of two over the longest delay
+constexpr int DELAY_SIZE = MAX_CHAIN_LATENCY * 2;
+// Where the task count starts in nextTask, the index below it only runs
+// past the count by one per thread
+constexpr int TASK_COUNT_SHIFT = 16;
+
+class BandChains::Worker : public juce::Thread {
+   public:
+    Worker(BandChains& owner, int index)
+        : juce::Thread("Band chains " + juce::String(index + 1)),
+          owner(owner) {}
+    ~Worker() override { stopThread(1000); }
+
+    void run() override {
+        juce::ScopedNoDenormals noDenormals;
+        while (!threadShouldExit()) {
+            wait(-1);
+            while (owner.runTask()) {
+            }
+        }
+    }
+
+   private:
+    BandChains& owner;
+};
+
+// Closing only hides it, the editor lives as long as its plugin
+class BandChains::EditorWindow : public juce::DocumentWindow {
+   public:
+    EditorWindow(juce::AudioProcessorEditor* editor, const juce::String& name)
+        : juce::DocumentWindow(name, juce::Colours::black,
+                               juce::DocumentWindow::closeButton) {
+        setUsingNativeTitleBar(true);
+        setContentOwned(editor, true);
+        setResizable(editor->isResizable(), false);
+        centreWithSize(getWidth(), getHeight());
+        setVisible(true);
+    }
+
+    void closeButtonPressed() override { setVisible(false); }
+};
+
+BandChains::BandChains() {
+#if JUCE_PLUGINHOST_VST3
+    formats.addFormat(new juce::VST3PluginFormat());
+#endif
+    for (Chain& chain : chains) chain.slots.reserve(MAX_CHAIN_PLUGINS);
+    for (juce::MidiBuffer& buffer : midi) buffer.ensureSize(256);
+}
+
+BandChains::~BandChains() {
+    // They run tasks on the chains
+    workers.clear();
+}
+
+void BandChains::prepare(double sampleRate, int blockSize, int channels) {
+    const juce::SpinLock::ScopedLockType scoped(lock);
+    this->sampleRate = sampleRate;
+    this->blockSize = blockSize;
+    this->preparedChannels = channels;
+    spareChannels.setSize(MAX_BANDS * MAX_CHANNELS, blockSize);
+    for (Chain& chain : chains)
+        for (Slot& slot : chain.slots) preparePlugin(*slot.plugin);
+}
+
+void BandChains::preparePlugin(juce::AudioPluginInstance& plugin) {
+    plugin.releaseResources();
+    plugin.setPlayConfigDetails(preparedChannels, preparedChannels, sampleRate,
+                                blockSize);
+    plugin.prepareToPlay(sampleRate, blockSize);
+}
+
+bool BandChains::loadPlugin(int band, const juce::File& file,
+                            juce::String& error) {
+    juce::OwnedArray<juce::PluginDescription> found;
+    for (juce::AudioPluginFormat* format : formats.getFormats())
+        format->findAllTypesForFile(found, file.getFullPathName());
+    if (found.isEmpty()) {
+        error = "No plugin found in " + file.getFileName();
+        return false;
+    }
+
+    std::unique_ptr<juce::AudioPluginInstance> plugin =
+        formats.createPluginInstance(*found[0], sampleRate, blockSize, error);
+    if (plugin == nullptr) return false;
+    return addPlugin(band, std::move(plugin), error);
+}
+
+bool BandChains::addPlugin(int band,
+                           std::unique_ptr<juce::AudioPluginInstance> plugin,
+                           juce::String& error) {
+    if ((int)chains[band].slots.size() >= MAX_CHAIN_PLUGINS) {
+        error = "Band " + juce::String(band + 1) + " already runs " +
+                juce::String(MAX_CHAIN_PLUGINS) + " plugins";
+        return false;
+    }
+
+    // Side chains and extra outputs would want channels the band hasn't got
+    plugin->disableNonMainBuses();
+    preparePlugin(*plugin);
+    if (plugin->getTotalNumInputChannels() > MAX_CHANNELS ||
+        plugin->getTotalNumOutputChannels() > MAX_CHANNELS) {
+        error = plugin->getName() + " needs more than " +
+                juce::String(MAX_CHANNELS) + " channels";
+        return false;
+    }
+
+    startWorkers();
+    // The slots were reserved, nothing is allocated under the lock
+    const juce::SpinLock::ScopedLockType scoped(lock);
+    chains[band].slots.push_back({std::move(plugin), nullptr});
+    plugins++;
+    return true;
+}
+
+void BandChains::startWorkers() {
+    // Only the message thread changes them, they are checked without the
+    // lock and the audio thread only waits for the swap
+    std::unique_ptr<float[], FreeDeleter> lines;
+    if (delayLines == nullptr)
+        lines.reset((float*)std::calloc(
+            (size_t)MAX_BANDS * MAX_CHANNELS * DELAY_SIZE, sizeof(float)));
+
+    // The audio thread runs a band too
+    std::vector<std::unique_ptr<Worker>> started;
+    const int count =
+        workers.empty()
+            ? std::min(juce::SystemStats::getNumCpus() - 1, MAX_BANDS - 1)
+            : 0;
+    for (int i = 0; i < count; i++) {
+        started.push_back(std::make_unique<Worker>(*this, i));
+        started.back()->startRealtimeThread(
+            juce::Thread::RealtimeOptions().withApproximateAudioProcessingTime(
+                blockSize, sampleRate));
+    }
+    if (lines == nullptr && started.empty()) return;
+
+    const juce::SpinLock::ScopedLockType scoped(lock);
+    if (lines != nullptr) delayLines.swap(lines);
+    if (!started.empty()) workers.swap(started);
+}
+
+void BandChains::clear(int band) {
+    // Destroyed once the audio thread can't reach them anymore
+    std::vector<Slot> removed;
+    {
+        const juce::SpinLock::ScopedLockType scoped(lock);
+        removed.swap(chains[band].slots);
+        chains[band].slots.reserve(MAX_CHAIN_PLUGINS);
+        plugins -= (int)removed.size();
+    }
+    for (Slot& slot : removed) slot.plugin->releaseResources();
+}
+
+juce::StringArray BandChains::getPluginNames(int band) const {
+    juce::StringArray names;
+    for (const Slot& slot : chains[band].slots)
+        names.add(slot.plugin->getName());
+    return names;
+}
+
+void BandChains::showEditor(int band, int slot) {
+    Slot& s = chains[band].slots[slot];
+    if (s.window != nullptr) {
+        s.window->setVisible(true);
+        s.window->toFront(true);
+        return;
+    }
+    juce::AudioProcessorEditor* editor = s.plugin->createEditorIfNeeded();
+    if (editor == nullptr) return;
+    s.window = std::make_unique<EditorWindow>(
+        editor, "Band " + juce::String(band + 1) + " - " + s.plugin->getName());
+}
+
+void BandChains::process(float* const* outputs, int bands, int channels,
+                         int samples) {
+    if (isEmpty()) {
+        latency = 0;
+        return;
+    }
+    const juce::SpinLock::ScopedTryLockType scoped(lock);
+    if (!scoped.isLocked()) return;
+
+    // Plugins may change their latency at any block
+    int longest = 0, taskCount = 0;
+    for (int j = 0; j < bands; j++) {
+        Chain& chain = chains[j];
+        chain.latency = 0;
+        for (const Slot& slot : chain.slots)
+            chain.latency += slot.plugin->getLatencySamples();
+        chain.latency = std::min(chain.latency, MAX_CHAIN_LATENCY);
+        longest = std::max(longest, chain.latency);
+        if (!chain.slots.empty() && outputs[j * channels] != nullptr)
+            tasks[taskCount++] = j;
+    }
+
+    taskOutputs = outputs;
+    taskChannels = channels;
+    taskSamples = samples;
+    pendingTasks.store(taskCount, std::memory_order_relaxed);
+    nextTask.store(taskCount << TASK_COUNT_SHIFT, std::memory_order_release);
+    const int helpers = std::min(taskCount - 1, (int)workers.size());
+    for (int i = 0; i < helpers; i++) workers[i]->notify();
+    while (runTask()) {
+    }
+    while (pendingTasks.load(std::memory_order_acquire) > 0)
+        std::this_thread::yield();
+    // Late workers find nothing left until the next block is handed over
+    nextTask.store(0, std::memory_order_relaxed);
+
+    latency = longest;
+    if (longest == 0) return;
+    for (int j = 0; j < bands; j++) {
+        if (outputs[j * channels] != nullptr)
+            delayBand(j, longest - chains[j].latency);
+    }
+    delayPos = (delayPos + samples) & (DELAY_SIZE - 1);
+}
+
+bool BandChains::runTask() {
+    const int next = nextTask.fetch_add(1, std::memory_order_acq_rel);
+    // The count comes from the same block as the index, 0 once it's done
+    const int task = next & ((1 << TASK_COUNT_SHIFT) - 1);
+    if (task >= next >> TASK_COUNT_SHIFT) return false;
+    processChain(tasks[task]);
+    pendingTasks.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void BandChains::processChain(int band) {
+    const int channels = std::min(taskChannels, MAX_CHANNELS);
+    juce::MidiBuffer& events = midi[band];
+
+    for (int start = 0; start < taskSamples; start += blockSize) {
+        const int count = std::min(blockSize, taskSamples - start);
+        float* buffers[MAX_CHANNELS];
+        for (int c = 0; c < MAX_CHANNELS; c++) {
+            if (c < channels) {
+                buffers[c] = taskOutputs[band * taskChannels + c] + start;
+                continue;
+            }
+            // Plugins wanting more channels get copies of the first one
+            buffers[c] = spareChannels.getWritePointer(band * MAX_CHANNELS + c);
+            std::memcpy(buffers[c], buffers[0], count * sizeof(float));
+        }
+
+        for (const Slot& slot : chains[band].slots) {
+            juce::AudioPluginInstance& plugin = *slot.plugin;
+            const int wanted = std::max(plugin.getTotalNumInputChannels(),
+                                        plugin.getTotalNumOutputChannels());
+            // Its layout changed behind our back
+            if (wanted > MAX_CHANNELS) continue;
+            // A mono plugin on a stereo band gets the downmix, and its
+            // output goes to both sides
+            const bool downmix = wanted == 1 && channels == 2;
+            if (downmix) {
+                for (int i = 0; i < count; i++)
+                    buffers[0][i] = .5f * (buffers[0][i] + buffers[1][i]);
+            }
+            juce::AudioBuffer<float> buffer(buffers, wanted, count);
+            events.clear();
+            plugin.processBlock(buffer, events);
+            if (downmix)
+                std::memcpy(buffers[1], buffers[0], count * sizeof(float));
+        }
+    }
+}
+
+void BandChains::delayBand(int band, int delay) {
+    for (int c = 0; c < taskChannels; c++) {
+        float* data = taskOutputs[band * taskChannels + c];
+        float* line =
+            delayLines.get() + (size_t)(band * MAX_CHANNELS + c) * DELAY_SIZE;
+        // Written before being read, a delay of 0 gives the sample back
+        for (int i = 0; i < taskSamples; i++) {
+            line[(delayPos + i) & (DELAY_SIZE - 1)] = data[i];
+            data[i] = line[(delayPos + i - delay) & (DELAY_SIZE - 1)];
+        }
+    }
+}
+
+std::unique_ptr<juce::XmlElement> BandChains::createXml() const {
+    auto xml = std::make_unique<juce::XmlElement>("CHAINS");
+    for (int j = 0; j < MAX_BANDS; j++) {
+        if (chains[j].slots.empty()) continue;
+        juce::XmlElement* band = xml->createNewChildElement("BAND");
+        band->setAttribute("index", j);
+        for (const Slot& slot : chains[j].slots) {
+            std::unique_ptr<juce::XmlElement> plugin =
+                slot.plugin->getPluginDescription().createXml();
+            juce::MemoryBlock state;
+            slot.plugin->getStateInformation(state);
+            plugin->setAttribute("state", state.toBase64Encoding());
+            band->addChildElement(plugin.release());
+        }
+    }
+    return xml;
+}
+
+void BandChains::restoreXml(const juce::XmlElement& xml) {
+    for (int j = 0; j < MAX_BANDS; j++) clear(j);
+
+    for (const juce::XmlElement* band :
+         xml.getChildWithTagNameIterator("BAND")) {
+        const int j = band->getIntAttribute("index", -1);
+        if (j < 0 || j >= MAX_BANDS) continue;
+        for (const juce::XmlElement* child : band->getChildIterator()) {
+            juce::PluginDescription description;
+            if (!description.loadFromXml(*child)) continue;
+
+            juce::String error;
+            std::unique_ptr<juce::AudioPluginInstance> plugin =
+                formats.createPluginInstance(description, sampleRate,
+                                             blockSize, error);
+            if (plugin == nullptr) {
+                DBG("Band " << j + 1 << ": " << error);
+                continue;
+            }
+            juce::MemoryBlock state;
+            state.fromBase64Encoding(child->getStringAttribute("state"));
+            plugin->setStateInformation(state.getData(), (int)state.getSize());
+            if (!addPlugin(j, std::move(plugin), error))
+                DBG("Band " << j + 1 << ": " << error);
+        }
+    }
+}
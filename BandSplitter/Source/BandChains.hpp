@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "JuceHeader.h"
+
+#include "SplitterEngine.hpp"
+
+// Most plugins a band can run
+constexpr int MAX_CHAIN_PLUGINS = 4;
+// Longest chain latency the bands are realigned for, in samples
+constexpr int MAX_CHAIN_LATENCY = 1 << 15;
+
+// Plugins hosted on each band, so that heavy per-band processing stays in
+// one track instead of going through the host mixer. The band chains run
+// side by side on a pool of real-time threads the audio thread waits for,
+// then the bands with shorter chains are delayed to line up with the
+// longest one.
+class BandChains {
+   public:
+    BandChains();
+    ~BandChains();
+
+    // Message thread. Plugins loaded before are prepared again.
+    void prepare(double sampleRate, int blockSize, int channels);
+
+    // Message thread. Appends the first plugin found in the file to the band's
+    // chain, false with the error filled in when it can't
+    bool loadPlugin(int band, const juce::File& file, juce::String& error);
+    void clear(int band);
+    juce::StringArray getPluginNames(int band) const;
+    inline int getPluginCount(int band) const {
+        return (int)chains[band].slots.size();
+    }
+    // Opens the plugin's own editor in a window of its own
+    void showEditor(int band, int slot);
+
+    // Audio thread. Runs the chain of every band over its channels in place,
+    // the outputs are laid out like SplitterEngine::process's. Bands are
+    // then all late by getLatencySamples(). Chains being changed are
+    // skipped for the block.
+    void process(float* const* outputs, int bands, int channels, int samples);
+    inline bool isEmpty() const { return plugins.load() == 0; }
+    inline int getLatencySamples() const { return latency.load(); }
+
+    // Plugin descriptions and states, restored on the message thread
+    std::unique_ptr<juce::XmlElement> createXml() const;
+    void restoreXml(const juce::XmlElement& xml);
+
+   private:
+    class Worker;
+    class EditorWindow;
+
+    struct Slot {
+        std::unique_ptr<juce::AudioPluginInstance> plugin;
+        std::unique_ptr<EditorWindow> window;
+    };
+    struct Chain {
+        std::vector<Slot> slots;
+        int latency = 0;
+    };
+
+    bool addPlugin(int band, std::unique_ptr<juce::AudioPluginInstance> plugin,
+                   juce::String& error);
+    void preparePlugin(juce::AudioPluginInstance& plugin);
+    // Starts the workers and allocates the delay lines on the first plugin,
+    // then swaps them in under the lock
+    void startWorkers();
+
+    // Audio thread, from the workers too
+    void processChain(int band);
+    bool runTask();
+    void delayBand(int band, int delay);
+
+    juce::AudioPluginFormatManager formats;
+    std::array<Chain, MAX_BANDS> chains;
+    std::atomic<int> plugins{0}, latency{0};
+    // Held by the audio thread for the whole block, and by the message
+    // thread while it changes a chain
+    juce::SpinLock lock;
+
+    double sampleRate = 44100;
+    int blockSize = 512, preparedChannels = 2;
+
+    // Blocks are handed over to the workers through these, every task is
+    // the chain of one band. nextTask holds the task count of the block
+    // above the index of the next task, so that a worker late from a block
+    // never compares its index with the count of the next one.
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::array<int, MAX_BANDS> tasks = {};
+    std::atomic<int> nextTask{0}, pendingTasks{0};
+    float* const* taskOutputs = nullptr;
+    int taskChannels = 0, taskSamples = 0;
+
+    // Channels the plugins expect beyond the ones the bands have, fed with
+    // a copy of the first one
+    juce::AudioBuffer<float> spareChannels;
+    std::array<juce::MidiBuffer, MAX_BANDS> midi;
+
+    // One delay line per band channel sharing the write position, from
+    // calloc like the engine's
+    struct FreeDeleter {
+        void operator()(float* data) const { std::free(data); }
+    };
+    std::unique_ptr<float[], FreeDeleter> delayLines;
+    int delayPos = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BandChains)
+};
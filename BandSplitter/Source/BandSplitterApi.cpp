@@ -0,0 +1,122 @@
+#include "BandSplitterApi.h"
+
+#include "SplitterEngine.hpp"
+
+struct BandSplitter {
+    SplitterEngine engine;
+};
+
+BandSplitter* bandsplitter_create(void) { return new BandSplitter(); }
+
+void bandsplitter_destroy(BandSplitter* splitter) { delete splitter; }
+
+void bandsplitter_prepare(BandSplitter* splitter, double sampleRate) {
+    splitter->engine.prepare(sampleRate);
+}
+
+void bandsplitter_reset(BandSplitter* splitter) { splitter->engine.reset(); }
+
+void bandsplitter_prepare_rate(BandSplitter* splitter, double sampleRate) {
+    if (sampleRate <= 0) return;
+    splitter->engine.prepareDesigns(sampleRate,
+                                    splitter->engine.getSplitType());
+}
+
+void bandsplitter_set_bands(BandSplitter* splitter, int bands) {
+    splitter->engine.setBands(bands);
+}
+
+void bandsplitter_set_type(BandSplitter* splitter, int type) {
+    if (type < 0 || type >= SPLIT_TYPES) return;
+    splitter->engine.setSplitType((SplitType)type);
+}
+
+void bandsplitter_set_split(BandSplitter* splitter, int split,
+                            float frequency) {
+    if (split < 0 || split >= MAX_BANDS - 1) return;
+    splitter->engine.setSplitFrequency(split, frequency);
+}
+
+void bandsplitter_add_split_event(BandSplitter* splitter, int offset,
+                                  int split, float frequency) {
+    if (split < 0 || split >= MAX_BANDS - 1) return;
+    splitter->engine.addSplitEvent(offset, split, frequency);
+}
+
+void bandsplitter_set_split_topology(BandSplitter* splitter, int split,
+                                     int topology) {
+    if (split < 0 || split >= MAX_BANDS - 1) return;
+    if (topology != TOPOLOGY_DIRECT && topology != TOPOLOGY_SVF) return;
+    splitter->engine.setSplitTopology(split, (SplitTopology)topology);
+}
+
+void bandsplitter_set_gain(BandSplitter* splitter, int band, float gain) {
+    if (band < 0 || band >= MAX_BANDS) return;
+    splitter->engine.setBandGain(band, gain);
+}
+
+void bandsplitter_set_mute(BandSplitter* splitter, int band, int mute) {
+    if (band < 0 || band >= MAX_BANDS) return;
+    splitter->engine.setBandMute(band, mute != 0);
+}
+
+void bandsplitter_set_solo(BandSplitter* splitter, int band, int solo) {
+    if (band < 0 || band >= MAX_BANDS) return;
+    splitter->engine.setBandSolo(band, solo != 0);
+}
+
+void bandsplitter_set_alignment(BandSplitter* splitter, int enabled) {
+    splitter->engine.setAlignment(enabled != 0);
+}
+
+void bandsplitter_set_modulation(BandSplitter* splitter, int source,
+                                 float rate, float depth) {
+    if (source < MOD_OFF || source > MOD_ENVELOPE) return;
+    splitter->engine.setModulation((ModSource)source, rate, depth);
+}
+
+void bandsplitter_set_split_modulation(BandSplitter* splitter, int split,
+                                       int enabled) {
+    if (split < 0 || split >= MAX_BANDS - 1) return;
+    splitter->engine.setSplitModulation(split, enabled != 0);
+}
+
+void bandsplitter_set_fir_budget(BandSplitter* splitter, int taps) {
+    splitter->engine.setFirBudget(taps);
+}
+
+void bandsplitter_set_stereo_mode(BandSplitter* splitter, int mode) {
+    if (mode != STEREO_LR && mode != STEREO_MS) return;
+    splitter->engine.setStereoMode((StereoMode)mode);
+}
+
+void bandsplitter_set_mono_bands(BandSplitter* splitter, int bands) {
+    splitter->engine.setMonoBands(bands);
+}
+
+void bandsplitter_set_idle_detection(BandSplitter* splitter, int enabled) {
+    splitter->engine.setIdleDetection(enabled != 0);
+}
+
+void bandsplitter_set_bit_exact(BandSplitter* splitter, int enabled) {
+    splitter->engine.setBitExact(enabled != 0);
+}
+
+void bandsplitter_process(BandSplitter* splitter, const float* const* inputs,
+                          int channels, float* const* outputs, int samples) {
+    if (channels < 1 || channels > MAX_CHANNELS || samples <= 0) return;
+    splitter->engine.process(inputs, channels, outputs, samples);
+}
+
+float bandsplitter_get_group_delay(const BandSplitter* splitter, int band) {
+    if (band < 0 || band >= MAX_BANDS) return 0;
+    return splitter->engine.getBandGroupDelay(band);
+}
+
+double bandsplitter_get_tail_seconds(const BandSplitter* splitter) {
+    return splitter->engine.getTailLengthSeconds();
+}
+
+int bandsplitter_get_latency(const BandSplitter* splitter) {
+    return splitter->engine.getLatencySamples();
+}
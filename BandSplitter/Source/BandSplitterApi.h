@@ -0,0 +1,75 @@
+#pragma once
+
+// C interface to the split engine for programs that don't use JUCE, C++
+// programs can use SplitterEngine directly
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct BandSplitter BandSplitter;
+
+BandSplitter* bandsplitter_create(void);
+void bandsplitter_destroy(BandSplitter* splitter);
+
+// Allocates the engine buffers, call it before processing and whenever the
+// sample rate changes
+void bandsplitter_prepare(BandSplitter* splitter, double sampleRate);
+void bandsplitter_reset(BandSplitter* splitter);
+// Designs the current splits at a rate the host may switch to, so that the
+// bandsplitter_prepare for it only copies coefficients
+void bandsplitter_prepare_rate(BandSplitter* splitter, double sampleRate);
+
+void bandsplitter_set_bands(BandSplitter* splitter, int bands);
+// One of the SplitType values, 0 is Linkwitz-Riley 4
+void bandsplitter_set_type(BandSplitter* splitter, int type);
+void bandsplitter_set_split(BandSplitter* splitter, int split, float frequency);
+// Moves a split at a sample offset of the next bandsplitter_process call,
+// for automation that has to land on its exact sample
+void bandsplitter_add_split_event(BandSplitter* splitter, int offset,
+                                  int split, float frequency);
+// 0 runs the split as direct form biquads, 1 as state variable filters that
+// keep their precision at low frequencies and high sample rates
+void bandsplitter_set_split_topology(BandSplitter* splitter, int split,
+                                     int topology);
+void bandsplitter_set_gain(BandSplitter* splitter, int band, float gain);
+// Muted or unsoloed bands fade out and stop being computed, non-zero sets
+void bandsplitter_set_mute(BandSplitter* splitter, int band, int mute);
+void bandsplitter_set_solo(BandSplitter* splitter, int band, int solo);
+// Delays the bands so that they line up with the slowest one
+void bandsplitter_set_alignment(BandSplitter* splitter, int enabled);
+// One of the ModSource values (0 off, 1 LFO, 2 envelope), the rate in Hz and
+// the depth in octaves, then whether each split follows it
+void bandsplitter_set_modulation(BandSplitter* splitter, int source,
+                                 float rate, float depth);
+void bandsplitter_set_split_modulation(BandSplitter* splitter, int split,
+                                       int enabled);
+// Taps the highest splits can spend on linear phase FIRs, 0 keeps them IIR
+void bandsplitter_set_fir_budget(BandSplitter* splitter, int taps);
+// 0 gives stereo bands as left/right, 1 as mid/side
+void bandsplitter_set_stereo_mode(BandSplitter* splitter, int mode);
+// Sums the lowest bands to mono, their side is never filtered
+void bandsplitter_set_mono_bands(BandSplitter* splitter, int bands);
+// On by default, offline renders turn it off to stay independent of the
+// block size
+void bandsplitter_set_idle_detection(BandSplitter* splitter, int enabled);
+// Off by default, mono splits then run faster with a rounding that depends
+// on where the blocks are cut. Renders that must not depend on the block
+// size turn it on.
+void bandsplitter_set_bit_exact(BandSplitter* splitter, int enabled);
+
+// Splits 1 or 2 planar input channels, outputs holds bands * channels planar
+// buffers with the channels of band j at j * channels, a null buffer skips
+// its band
+void bandsplitter_process(BandSplitter* splitter, const float* const* inputs,
+                          int channels, float* const* outputs, int samples);
+
+// Group delay of a band in samples
+float bandsplitter_get_group_delay(const BandSplitter* splitter, int band);
+double bandsplitter_get_tail_seconds(const BandSplitter* splitter);
+// Delay of the linear phase splits in samples, the same for every band
+int bandsplitter_get_latency(const BandSplitter* splitter);
+
+#ifdef __cplusplus
+}
+#endif
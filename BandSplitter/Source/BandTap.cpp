@@ -0,0 +1,158 @@
+#include "BandTap.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+// Shared memory and the atomic builtins the header fields are accessed with
+#if (defined(__unix__) || defined(__APPLE__)) && defined(__GNUC__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define BANDTAP_POSIX 1
+#endif
+
+// The rings start on their own page
+constexpr std::size_t DATA_OFFSET = 4096;
+static_assert(sizeof(BandTapHeader) <= DATA_OFFSET, "header fits its page");
+
+BandTap::~BandTap() { close(); }
+
+std::string BandTap::createName() {
+    static std::atomic<int> instances{0};
+#ifdef BANDTAP_POSIX
+    const long pid = (long)getpid();
+#else
+    const long pid = 0;
+#endif
+    return BANDTAP_NAME_PREFIX + std::to_string(pid) + "-" +
+           std::to_string(++instances);
+}
+
+bool BandTap::open(const std::string& name, double sampleRate) {
+    close();
+#ifdef BANDTAP_POSIX
+    const std::size_t size =
+        DATA_OFFSET + (std::size_t)BANDTAP_SLOTS * BANDTAP_CAPACITY * 4;
+    const int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    void* memory = MAP_FAILED;
+    if (ftruncate(fd, (off_t)size) == 0)
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    // A fresh object reads as zeros, silence until the first block
+    BandTapHeader* h = (BandTapHeader*)memory;
+    h->version = BANDTAP_VERSION;
+    h->dataOffset = DATA_OFFSET;
+    h->capacity = BANDTAP_CAPACITY;
+    h->slots = BANDTAP_SLOTS;
+    h->sampleRate = sampleRate;
+    // Readers check the magic last
+    __atomic_store_n(&h->magic, BANDTAP_MAGIC, __ATOMIC_RELEASE);
+
+    bool expected = false;
+    while (!busy.compare_exchange_weak(expected, true)) {
+        expected = false;
+        std::this_thread::yield();
+    }
+    this->name = name;
+    this->size = size;
+    this->data = (float*)((char*)memory + DATA_OFFSET);
+    this->header = h;
+    busy.store(false, std::memory_order_release);
+    opened = true;
+    return true;
+#else
+    (void)name;
+    (void)sampleRate;
+    return false;
+#endif
+}
+
+void BandTap::close() {
+    if (header == nullptr) return;
+    bool expected = false;
+    while (!busy.compare_exchange_weak(expected, true)) {
+        expected = false;
+        std::this_thread::yield();
+    }
+    BandTapHeader* h = header;
+    header = nullptr;
+    data = nullptr;
+    busy.store(false, std::memory_order_release);
+    opened = false;
+
+#ifdef BANDTAP_POSIX
+    // Readers keep their mapping until they close it
+    munmap(h, size);
+    shm_unlink(name.c_str());
+#endif
+    name.clear();
+}
+
+void BandTap::setSampleRate(double sampleRate) {
+#ifdef BANDTAP_POSIX
+    if (header == nullptr) return;
+    __atomic_store(&header->sampleRate, &sampleRate, __ATOMIC_RELAXED);
+#else
+    (void)sampleRate;
+#endif
+}
+
+void BandTap::write(const float* const* outputs, int bands, int channels,
+                    int samples) {
+#ifdef BANDTAP_POSIX
+    if (busy.exchange(true, std::memory_order_acquire)) return;
+    BandTapHeader* h = header;
+    if (h == nullptr || samples <= 0) {
+        busy.store(false, std::memory_order_release);
+        return;
+    }
+
+    // Blocks longer than the ring only keep their end
+    const int skipped = std::max(0, samples - (int)BANDTAP_CAPACITY);
+    samples -= skipped;
+    const uint64_t pos = h->writePos;
+    const uint64_t end = pos + samples;
+    __atomic_store_n(&h->bands, (uint32_t)bands, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->channels, (uint32_t)channels, __ATOMIC_RELAXED);
+    // Readers have to see the frames being overwritten announced before
+    // anything is written over them
+    __atomic_store_n(&h->writeEnd, end, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    const uint32_t mask = BANDTAP_CAPACITY - 1;
+    const uint32_t start = (uint32_t)pos & mask;
+    const int first = std::min(samples, (int)(BANDTAP_CAPACITY - start));
+    for (int j = 0; j < BANDTAP_MAX_BANDS; j++) {
+        for (int c = 0; c < BANDTAP_MAX_CHANNELS; c++) {
+            float* ring = data + (std::size_t)(j * BANDTAP_MAX_CHANNELS + c) *
+                                     BANDTAP_CAPACITY;
+            const float* band = j < bands && c < channels
+                                    ? outputs[j * channels + c]
+                                    : nullptr;
+            if (band == nullptr) {
+                std::memset(ring + start, 0, first * sizeof(float));
+                std::memset(ring, 0, (samples - first) * sizeof(float));
+                continue;
+            }
+            band += skipped;
+            std::memcpy(ring + start, band, first * sizeof(float));
+            std::memcpy(ring, band + first, (samples - first) * sizeof(float));
+        }
+    }
+
+    __atomic_store_n(&h->writePos, end, __ATOMIC_RELEASE);
+    busy.store(false, std::memory_order_release);
+#else
+    (void)outputs;
+    (void)bands;
+    (void)channels;
+    (void)samples;
+#endif
+}
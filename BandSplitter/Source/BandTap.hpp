@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+#include "BandTapApi.h"
+#include "SplitterEngine.hpp"
+
+static_assert(MAX_BANDS == BANDTAP_MAX_BANDS &&
+                  MAX_CHANNELS == BANDTAP_MAX_CHANNELS,
+              "the tap has a slot for every band channel");
+
+// Writes the bands into a shared memory ring other processes read with
+// BandTapApi.h. The audio thread never waits for them, readers that fall a
+// ring behind lose frames. Only available where POSIX shared memory is.
+class BandTap {
+   public:
+    ~BandTap();
+
+    // Message thread. Creates the shared memory object, false if it can't.
+    // The name starts with a slash, as shm_open wants it.
+    bool open(const std::string& name, double sampleRate);
+    void close();
+    inline bool isOpen() const { return opened.load(); }
+    inline const std::string& getName() const { return name; }
+    void setSampleRate(double sampleRate);
+
+    // Audio thread. Outputs are laid out like SplitterEngine::process's,
+    // bands without a buffer are written as silence. Skipped for the block
+    // while the tap is being opened or closed.
+    void write(const float* const* outputs, int bands, int channels,
+               int samples);
+
+    // Name for the next tap of this process
+    static std::string createName();
+
+   private:
+    BandTapHeader* header = nullptr;
+    float* data = nullptr;
+    std::size_t size = 0;
+    std::string name;
+    // Held by the audio thread while it writes, and by the message thread
+    // while the mapping changes
+    std::atomic<bool> busy{false};
+    std::atomic<bool> opened{false};
+};
@@ -0,0 +1,152 @@
+#include "BandTapApi.h"
+
+#include <cstring>
+#include <new>
+
+// Shared memory and the atomic builtins the header fields are accessed with
+#if (defined(__unix__) || defined(__APPLE__)) && defined(__GNUC__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BANDTAP_POSIX 1
+#endif
+
+struct BandTapReader {
+    void* memory;
+    size_t size;
+    const BandTapHeader* header;
+    uint64_t readPos, lost;
+};
+
+BandTapReader* bandtap_open(const char* name) {
+#ifdef BANDTAP_POSIX
+    const int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return nullptr;
+    struct stat info;
+    void* memory = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(BandTapHeader))
+        memory = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) return nullptr;
+
+    const BandTapHeader* header = (const BandTapHeader*)memory;
+    const size_t needed =
+        header->dataOffset + (size_t)header->capacity * header->slots * 4;
+    if (header->magic != BANDTAP_MAGIC || header->version != BANDTAP_VERSION ||
+        header->slots != BANDTAP_SLOTS || header->capacity == 0 ||
+        (header->capacity & (header->capacity - 1)) != 0 ||
+        needed > (size_t)info.st_size) {
+        munmap(memory, info.st_size);
+        return nullptr;
+    }
+
+    BandTapReader* reader = new (std::nothrow) BandTapReader();
+    if (reader == nullptr) {
+        munmap(memory, info.st_size);
+        return nullptr;
+    }
+    reader->memory = memory;
+    reader->size = info.st_size;
+    reader->header = header;
+    reader->readPos = __atomic_load_n(&header->writePos, __ATOMIC_ACQUIRE);
+    reader->lost = 0;
+    return reader;
+#else
+    (void)name;
+    return nullptr;
+#endif
+}
+
+void bandtap_close(BandTapReader* reader) {
+    if (reader == nullptr) return;
+#ifdef BANDTAP_POSIX
+    munmap(reader->memory, reader->size);
+#endif
+    delete reader;
+}
+
+const BandTapHeader* bandtap_get_header(const BandTapReader* reader) {
+    return reader->header;
+}
+
+#ifdef BANDTAP_POSIX
+int bandtap_peek(BandTapReader* reader, const float** channels, int frames) {
+    const BandTapHeader* header = reader->header;
+    const uint64_t written =
+        __atomic_load_n(&header->writePos, __ATOMIC_ACQUIRE);
+    // Whatever is more than a ring behind is gone, start over from the
+    // newest frames
+    if (written - reader->readPos > header->capacity) {
+        reader->lost += written - reader->readPos;
+        reader->readPos = written;
+    }
+
+    const uint32_t mask = header->capacity - 1;
+    const uint32_t start = (uint32_t)reader->readPos & mask;
+    uint64_t available = written - reader->readPos;
+    // Up to the end of the ring, the rest comes with the next peek
+    if (available > header->capacity - start)
+        available = header->capacity - start;
+    if (available > (uint64_t)frames) available = frames;
+
+    const float* data =
+        (const float*)((const char*)reader->memory + header->dataOffset);
+    for (int s = 0; s < BANDTAP_SLOTS; s++)
+        channels[s] = data + (size_t)s * header->capacity + start;
+    return (int)available;
+}
+
+int bandtap_release(BandTapReader* reader, int frames) {
+    // Orders the reads of the frames before the check, the writer announces
+    // writeEnd before it overwrites anything
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    const uint64_t end =
+        __atomic_load_n(&reader->header->writeEnd, __ATOMIC_RELAXED);
+    const uint64_t from = reader->readPos;
+    reader->readPos += frames;
+    if (end - from <= reader->header->capacity) return 1;
+    reader->lost += frames;
+    return 0;
+}
+
+int bandtap_read(BandTapReader* reader, float* const* outputs, int frames) {
+    int read = 0;
+    while (read < frames) {
+        const float* channels[BANDTAP_SLOTS];
+        const int count = bandtap_peek(reader, channels, frames - read);
+        if (count == 0) break;
+        for (int s = 0; s < BANDTAP_SLOTS; s++) {
+            if (outputs[s] != nullptr)
+                std::memcpy(outputs[s] + read, channels[s],
+                            count * sizeof(float));
+        }
+        // Overwritten frames are dropped from what was copied
+        if (bandtap_release(reader, count)) read += count;
+    }
+    return read;
+}
+
+#else
+int bandtap_peek(BandTapReader* reader, const float** channels, int frames) {
+    (void)reader;
+    (void)channels;
+    (void)frames;
+    return 0;
+}
+
+int bandtap_release(BandTapReader* reader, int frames) {
+    (void)reader;
+    (void)frames;
+    return 0;
+}
+
+int bandtap_read(BandTapReader* reader, float* const* outputs, int frames) {
+    (void)reader;
+    (void)outputs;
+    (void)frames;
+    return 0;
+}
+#endif
+
+uint64_t bandtap_get_lost(const BandTapReader* reader) { return reader->lost; }
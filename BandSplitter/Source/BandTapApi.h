@@ -0,0 +1,74 @@
+#pragma once
+
+// Shared memory layout of the band tap and a C reader for it. The plugin
+// writes every band into a POSIX shared memory object as it processes them,
+// programs in other processes read them from there.
+//
+// The object starts with a BandTapHeader, followed at dataOffset by one ring
+// of capacity floats per slot. Band j channel c lives in slot
+// j * BANDTAP_MAX_CHANNELS + c whatever the current layout, slots the bands
+// don't use hold silence. Frame n of every slot is at n & (capacity - 1).
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BANDTAP_MAGIC 0x50415442u
+#define BANDTAP_VERSION 1u
+#define BANDTAP_MAX_BANDS 8
+#define BANDTAP_MAX_CHANNELS 2
+#define BANDTAP_SLOTS (BANDTAP_MAX_BANDS * BANDTAP_MAX_CHANNELS)
+// Frames each ring holds, about 1.4 seconds at 48kHz
+#define BANDTAP_CAPACITY (1u << 16)
+// Shared memory objects of the plugin are named with this prefix, then the
+// process id and instance number
+#define BANDTAP_NAME_PREFIX "/bandsplitter-"
+
+typedef struct BandTapHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t dataOffset;
+    uint32_t capacity;
+    uint32_t slots;
+    // Layout of the newest frames, they may change at any block
+    uint32_t bands;
+    uint32_t channels;
+    uint32_t reserved;
+    double sampleRate;
+    // Frames published so far, and frames the writer is writing up to.
+    // Frames before writeEnd - capacity are being overwritten. Both only
+    // grow and are accessed atomically.
+    uint64_t writePos;
+    uint64_t writeEnd;
+} BandTapHeader;
+
+typedef struct BandTapReader BandTapReader;
+
+// Maps the shared memory object of a tap for reading, NULL if it doesn't
+// exist or isn't a tap. Reading starts at the newest frame.
+BandTapReader* bandtap_open(const char* name);
+void bandtap_close(BandTapReader* reader);
+
+const BandTapHeader* bandtap_get_header(const BandTapReader* reader);
+
+// Zero copy access. Points channels at the next frames of every slot inside
+// the ring and returns how many follow each other there, up to frames.
+// Readers that fell more than a ring behind skip to the newest frames.
+int bandtap_peek(BandTapReader* reader, const float** channels, int frames);
+// Moves past the frames of the last peek, returns 0 if the writer
+// overwrote them while they were being read
+int bandtap_release(BandTapReader* reader, int frames);
+
+// Copies up to frames frames of every slot into outputs, which holds
+// BANDTAP_SLOTS buffers (NULL to skip one). Returns the frames read, those
+// the writer overwrote meanwhile are counted as lost instead.
+int bandtap_read(BandTapReader* reader, float* const* outputs, int frames);
+
+// Frames the reader missed by falling behind the writer
+uint64_t bandtap_get_lost(const BandTapReader* reader);
+
+#ifdef __cplusplus
+}
+#endif
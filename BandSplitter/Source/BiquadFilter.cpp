@@ -154,4 +154,76 @@ void BiquadFilter::processBlockMul(float* buffer, int size, State state,
         state[times * 2] = yn;                    // y1 = yn
         buffer[i] = yn;
     }
+}
+
+void BiquadFilter::processCascade(const struct BiquadFilterCoefficients* coeffs,
+                                  std::size_t sections, float* buffer,
+                                  int size, State state) {
+    if (sections == 0) return;
+    for (int i = 0; i < size; i++) {
+        float xn = buffer[i], x1 = state[0], x2 = state[1], yn = 0, y1 = 0,
+              y2 = 0;
+        for (std::size_t j = 0; j < sections; j++) {
+            const struct BiquadFilterCoefficients& c = coeffs[j];
+            y1 = state[j * 2 + 2];
+            y2 = state[j * 2 + 3];
+
+            yn = c.b0 * xn + c.b1 * x1 + c.b2 * x2 - c.a1 * y1 - c.a2 * y2;
+
+            state[j * 2 + 1] = state[j * 2];  // x2 = x1
+            state[j * 2] = xn;                // x1 = xn
+
+            xn = yn;
+            x1 = y1;
+            x2 = y2;
+        }
+        state[sections * 2 + 1] = state[sections * 2];  // y2 = y1
+        state[sections * 2] = yn;                       // y1 = yn
+        buffer[i] = yn;
+    }
+}
+
+void BiquadFilter::processSvfCascade(const struct SvfCoefficients* coeffs,
+                                     std::size_t sections, float* buffer,
+                                     int size, State state) {
+    for (int i = 0; i < size; i++) {
+        float xn = buffer[i];
+        for (std::size_t j = 0; j < sections; j++) {
+            const struct SvfCoefficients& c = coeffs[j];
+            const float ic1 = state[j * 2], ic2 = state[j * 2 + 1];
+            const float v3 = xn - ic2;
+            const float v1 = c.a1 * ic1 + c.a2 * v3;
+            const float v2 = ic2 + c.a2 * ic1 + c.a3 * v3;
+            state[j * 2] = 2 * v1 - ic1;
+            state[j * 2 + 1] = 2 * v2 - ic2;
+            xn = c.m0 * xn + c.m1 * v1 + c.m2 * v2;
+        }
+        buffer[i] = xn;
+    }
+}
+
+double BiquadFilter::getGroupDelay(
+    const struct BiquadFilterCoefficients& coeffs, double omega) {
+    // For P(z) = sum(p_k z^-k) the delay is Re(sum(k p_k z^-k) / P(z))
+    const std::complex<double> z1 = std::polar(1.0, -omega), z2 = z1 * z1;
+    const std::complex<double> b = (double)coeffs.b0 +
+                                   (double)coeffs.b1 * z1 +
+                                   (double)coeffs.b2 * z2;
+    const std::complex<double> a = (double)coeffs.a0 +
+                                   (double)coeffs.a1 * z1 +
+                                   (double)coeffs.a2 * z2;
+    const std::complex<double> db =
+        (double)coeffs.b1 * z1 + 2.0 * coeffs.b2 * z2;
+    const std::complex<double> da =
+        (double)coeffs.a1 * z1 + 2.0 * coeffs.a2 * z2;
+    return (db / b).real() - (da / a).real();
+}
+
+std::complex<double> BiquadFilter::getResponse(
+    const struct BiquadFilterCoefficients& coeffs, double omega) {
+    const std::complex<double> z1 = std::polar(1.0, -omega), z2 = z1 * z1;
+    return ((double)coeffs.b0 + (double)coeffs.b1 * z1 +
+            (double)coeffs.b2 * z2) /
+           ((double)coeffs.a0 + (double)coeffs.a1 * z1 +
+            (double)coeffs.a2 * z2);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cmath>
+#include <complex>
 #include <string>
 
 enum BiquadFilterType {
@@ -46,6 +47,22 @@ struct BiquadFilterCoefficients {
     float a2 = 0;
 };
 
+// Second order state variable filter section discretized with the
+// trapezoidal rule (topology preserving transform). The integrator states
+// stay close to the signal level at any cutoff, the coefficients keep their
+// precision where a direct form's a1 and a2 crowd towards -2 and 1. With
+// v1 and v2 the bandpass and lowpass outputs, y = m0 x + m1 v1 + m2 v2.
+struct SvfCoefficients {
+    // g = tan(pi f / rate), a1 = 1 / (1 + g (g + 1 / Q)), a2 = g a1,
+    // a3 = g a2, the defaults pass the input through
+    float a1 = 1;
+    float a2 = 0;
+    float a3 = 0;
+    float m0 = 1;
+    float m1 = 0;
+    float m2 = 0;
+};
+
 class BiquadFilter {
    public:
     BiquadFilter(int sampleRate = 44100);
@@ -76,6 +93,26 @@ class BiquadFilter {
     void processBlockMul(float* buffer, int size, State state,
                          std::size_t times) const;
 
+    // Runs a cascade of sections with normalized coefficients (a0 = 1), the
+    // state buffer has the same layout as processBlockMul's
+    static void processCascade(const struct BiquadFilterCoefficients* coeffs,
+                               std::size_t sections, float* buffer, int size,
+                               State state);
+
+    // Runs a cascade of state variable sections, the state buffer holds the
+    // two integrator states of each section where processCascade keeps x1
+    // and x2
+    static void processSvfCascade(const struct SvfCoefficients* coeffs,
+                                  std::size_t sections, float* buffer,
+                                  int size, State state);
+
+    // Group delay in samples at the normalized pulsation omega
+    static double getGroupDelay(const struct BiquadFilterCoefficients& coeffs,
+                                double omega);
+    // Complex frequency response at the normalized pulsation omega
+    static std::complex<double> getResponse(
+        const struct BiquadFilterCoefficients& coeffs, double omega);
+
    private:
     void updateParameters();
 
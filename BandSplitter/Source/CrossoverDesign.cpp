@@ -0,0 +1,215 @@
+#include "CrossoverDesign.hpp"
+
+#include <algorithm>
+
+// Prototypes are normalized to cross at -3dB (-6dB for LR4) at 1 rad/s and
+// their sections are sorted by increasing Q
+static const struct CrossoverDesign DESIGNS[SPLIT_TYPES] = {
+    {"Linkwitz-Riley 4",
+     2,
+     {{1, 0, 0, 1, 1.414213562f, 1}, {1, 0, 0, 1, 1.414213562f, 1}},
+     false,
+     {}},
+    {"Butterworth 4",
+     2,
+     {{1, 0, 0, 1, 1.847759065f, 1}, {1, 0, 0, 1, 0.765366865f, 1}},
+     false,
+     {}},
+    {"Butterworth 8",
+     4,
+     {{1, 0, 0, 1, 1.961570561f, 1},
+      {1, 0, 0, 1, 1.662939225f, 1},
+      {1, 0, 0, 1, 1.111140466f, 1},
+      {1, 0, 0, 1, 0.390180644f, 1}},
+     false,
+     {}},
+    {"Bessel 4",
+     2,
+     {{1, 0, 0, 1, 1.339663700f, 0.488904151f},
+      {1, 0, 0, 1, 0.774253975f, 0.388990734f}},
+     false,
+     {}},
+    // 0.5dB of passband ripple
+    {"Chebyshev 4",
+     2,
+     {{0.944060876f, 0, 0, 1, 2.596734647f, 3.352503073f},
+      {1, 0, 0, 1, 0.360461535f, 1.123508145f}},
+     false,
+     {}},
+    // 0.5dB of passband ripple, 50dB of stopband attenuation
+    {"Elliptic 4",
+     2,
+     {{0.944060876f, 0, 0.042070871f, 1, 2.344852833f, 2.871301556f},
+      {1, 0, 0.236797977f, 1, 0.309618370f, 1.097187082f}},
+     false,
+     {}},
+    // Butterworth 3, (s^2 - s + 1) / (s^2 + s + 1) is BiquadFilter's ALLPASS
+    // with Q = 1
+    {"Allpass 3",
+     2,
+     {{1, 0, 0, 1, 1, 0}, {1, 0, 0, 1, 1, 1}},
+     true,
+     {{1, -1, 1, 1, 1, 1}, {1, -1, 0, 1, 1, 0}}}};
+
+const struct CrossoverDesign& getCrossoverDesign(enum SplitType type) {
+    return DESIGNS[type];
+}
+
+double getSlowestDecay(enum SplitType type) {
+    const struct CrossoverDesign& design = DESIGNS[type];
+    double decay = 1;
+    for (std::size_t i = 0; i < design.sections; i++) {
+        const struct AnalogSection& s = design.lowpass[i];
+        if (s.a2 == 0) {
+            decay = std::min(decay, (double)s.a0 / s.a1);
+            continue;
+        }
+        // Real part of the poles of the lowpass and of the mirrored highpass
+        decay = std::min(decay, (double)s.a1 / (2 * s.a2));
+        decay = std::min(decay, (double)s.a1 / (2 * s.a0));
+    }
+    return decay;
+}
+
+struct BiquadFilterCoefficients bilinear(const struct AnalogSection& section,
+                                         float k) {
+    // A first order section through the second order transform would have
+    // a pole and a zero cancelling at z = -1
+    if (section.a2 == 0 && section.b2 == 0) {
+        const float a0 = section.a0 * k + section.a1;
+        return {.b0 = (section.b0 * k + section.b1) / a0,
+                .b1 = (section.b0 * k - section.b1) / a0,
+                .b2 = 0,
+                .a0 = 1,
+                .a1 = (section.a0 * k - section.a1) / a0,
+                .a2 = 0};
+    }
+    const float k2 = k * k;
+    const float a0 = section.a0 * k2 + section.a1 * k + section.a2;
+    return {.b0 = (section.b0 * k2 + section.b1 * k + section.b2) / a0,
+            .b1 = 2 * (section.b0 * k2 - section.b2) / a0,
+            .b2 = (section.b0 * k2 - section.b1 * k + section.b2) / a0,
+            .a0 = 1,
+            .a1 = 2 * (section.a0 * k2 - section.a2) / a0,
+            .a2 = (section.a0 * k2 - section.a1 * k + section.a2) / a0};
+}
+
+struct SvfCoefficients trapezoidal(const struct AnalogSection& section,
+                                   float k) {
+    // H(s) = (n0 + n1 s' + n2 s'^2) / (1 + q s' + s'^2) with s' = s / w0
+    float w0, q, n0, n1, n2;
+    if (section.a2 == 0 && section.b2 == 0) {
+        // (c0 + c1 s') / (1 + s') times (1 + s') / (1 + s')
+        w0 = section.a0 / section.a1;
+        q = 2;
+        const float c0 = section.b0 / section.a0,
+                    c1 = section.b1 * w0 / section.a0;
+        n0 = c0;
+        n1 = c0 + c1;
+        n2 = c1;
+    } else {
+        w0 = std::sqrt(section.a0 / section.a2);
+        q = section.a1 * w0 / section.a0;
+        n0 = section.b0 / section.a0;
+        n1 = section.b1 * w0 / section.a0;
+        n2 = section.b2 / section.a2;
+    }
+    const float g = k * w0;
+    const float a1 = 1 / (1 + g * (g + q)), a2 = g * a1;
+    // The highpass output is x - q v1 - v2
+    return {.a1 = a1,
+            .a2 = a2,
+            .a3 = g * a2,
+            .m0 = n2,
+            .m1 = n1 - n2 * q,
+            .m2 = n0 - n2};
+}
+
+std::size_t designSplit(enum SplitType type, float f, double sampleRate,
+                        struct BiquadFilterCoefficients* lp,
+                        struct BiquadFilterCoefficients* hp,
+                        struct BiquadFilterCoefficients* branches) {
+    // Keeps the prewarping away from the pole of tan at Nyquist
+    f = std::min(f, (float)(sampleRate * .49));
+    return designSplitWarped(type, std::tan(M_PI * f / sampleRate), lp, hp,
+                             branches);
+}
+
+std::size_t designSplitWarped(enum SplitType type, float k,
+                              struct BiquadFilterCoefficients* lp,
+                              struct BiquadFilterCoefficients* hp,
+                              struct BiquadFilterCoefficients* branches) {
+    const struct CrossoverDesign& design = DESIGNS[type];
+    for (std::size_t i = 0; i < design.sections; i++) {
+        const struct AnalogSection& s = design.lowpass[i];
+        lp[i] = bilinear(s, k);
+        // s -> 1/s, first order sections only have their first two terms
+        hp[i] = s.a2 == 0 && s.b2 == 0
+                    ? bilinear({s.b1, s.b0, 0, s.a1, s.a0, 0}, k)
+                    : bilinear({s.b2, s.b1, s.b0, s.a2, s.a1, s.a0}, k);
+    }
+    if (design.allpass && branches != nullptr) {
+        branches[0] = bilinear(design.branches[0], k);
+        branches[1] = bilinear(design.branches[1], k);
+    }
+    return design.sections;
+}
+
+std::size_t designSplitSvf(enum SplitType type, float f, double sampleRate,
+                           struct SvfCoefficients* lp,
+                           struct SvfCoefficients* hp) {
+    f = std::min(f, (float)(sampleRate * .49));
+    return designSplitSvfWarped(type, std::tan(M_PI * f / sampleRate), lp, hp);
+}
+
+std::size_t designSplitSvfWarped(enum SplitType type, float k,
+                                 struct SvfCoefficients* lp,
+                                 struct SvfCoefficients* hp) {
+    const struct CrossoverDesign& design = DESIGNS[type];
+    for (std::size_t i = 0; i < design.sections; i++) {
+        const struct AnalogSection& s = design.lowpass[i];
+        lp[i] = trapezoidal(s, k);
+        hp[i] = s.a2 == 0 && s.b2 == 0
+                    ? trapezoidal({s.b1, s.b0, 0, s.a1, s.a0, 0}, k)
+                    : trapezoidal({s.b2, s.b1, s.b0, s.a2, s.a1, s.a0}, k);
+    }
+    return design.sections;
+}
+
+int getFirSplitTaps(float f, double sampleRate) {
+    const double needed = FIR_TRANSITION * sampleRate / f;
+    int taps = MIN_FIR_TAPS;
+    while (taps < needed && taps < MAX_FIR_TAPS) taps = taps * 2 + 1;
+    return taps < needed ? 0 : taps;
+}
+
+void designFirSplit(float f, double sampleRate, float* taps, int length) {
+    const double fc = std::min(f / sampleRate, .49);
+    const int centre = (length - 1) / 2;
+    double sum = 0;
+    for (int k = 0; k < length; k++) {
+        const int n = k - centre;
+        const double sinc =
+            n == 0 ? 2 * fc : std::sin(2 * M_PI * fc * n) / (M_PI * n);
+        // Stretched by one sample on each side, its ends would be zeros
+        const double phase = 2 * M_PI * (k + 1) / (length + 1);
+        const double window =
+            .42 - .5 * std::cos(phase) + .08 * std::cos(2 * phase);
+        taps[k] = (float)(sinc * window);
+        sum += taps[k];
+    }
+    // Unity gain at DC, the highpass side then has none
+    for (int k = 0; k < length; k++) taps[k] = (float)(taps[k] / sum);
+}
+
+float fastPrewarp(float f, float sampleRate) {
+    const float x = M_PI * std::min(f / sampleRate, .49f);
+
+    // Pade approximant of tan on [0, pi/4], the upper half uses
+    // tan(x) = 1 / tan(pi/2 - x)
+    const bool upper = x > M_PI / 4;
+    const float y = upper ? M_PI / 2 - x : x, y2 = y * y;
+    const float t = y * (945 - 105 * y2 + y2 * y2) /
+                    (945 - 420 * y2 + 15 * y2 * y2);
+    return upper ? 1 / t : t;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+
+#include "BiquadFilter.hpp"
+
+enum SplitType {
+    LR4 = 0,
+    BUTTERWORTH4 = 1,
+    BUTTERWORTH8 = 2,
+    BESSEL4 = 3,
+    CHEBYSHEV4 = 4,
+    ELLIPTIC4 = 5,
+    ALLPASS3 = 6
+};
+
+constexpr int SPLIT_TYPES = 7;
+
+// Most second order sections a split filter can have
+constexpr std::size_t MAX_SECTIONS = 4;
+
+// Linear phase splits are 2^n - 1 taps long so that their delay is a whole
+// number of samples
+constexpr int MIN_FIR_TAPS = 15;
+constexpr int MAX_FIR_TAPS = 255;
+// Width of the Blackman window's transition band times its length, relative
+// to the sample rate
+constexpr double FIR_TRANSITION = 5.5;
+
+// Analog second order section normalized to a 1 rad/s crossover
+// H(s) = (b0 + b1 s + b2 s^2) / (a0 + a1 s + a2 s^2), first order sections
+// have b2 = a2 = 0
+struct AnalogSection {
+    float b0, b1, b2;
+    float a0, a1, a2;
+};
+
+// Lowpass prototype of a split, the highpass side is obtained with s -> 1/s
+// so that both sides cross at the same frequency
+struct CrossoverDesign {
+    const char* name;
+    std::size_t sections;
+    struct AnalogSection lowpass[MAX_SECTIONS];
+    // Doubly complementary splits are also the half sum (lowpass) and half
+    // difference (highpass) of two allpass branches, a second order one
+    // then a first order one. Running the branches costs half the
+    // multiplies of the cascades and both sides sum to an allpass.
+    bool allpass;
+    struct AnalogSection branches[2];
+};
+
+const struct CrossoverDesign& getCrossoverDesign(enum SplitType type);
+
+// Decay rate of the slowest pole of a split relative to its crossover
+// pulsation, used to estimate how long the filters ring
+double getSlowestDecay(enum SplitType type);
+
+// Bilinear transform prewarped at the crossover, k = tan(pi * f / rate)
+struct BiquadFilterCoefficients bilinear(const struct AnalogSection& section,
+                                         float k);
+
+// Same section as a state variable filter, the only transcendental is k.
+// First order sections become a second order one with a double pole, half
+// of which their numerator cancels.
+struct SvfCoefficients trapezoidal(const struct AnalogSection& section,
+                                   float k);
+
+// Computes the normalized (a0 = 1) lowpass and highpass sections of a split
+// at frequency f, returns the number of sections written in lp and hp.
+// The two allpass branches of doubly complementary splits go in branches
+// when given.
+std::size_t designSplit(enum SplitType type, float f, double sampleRate,
+                        struct BiquadFilterCoefficients* lp,
+                        struct BiquadFilterCoefficients* hp,
+                        struct BiquadFilterCoefficients* branches = nullptr);
+// Same with the prewarped frequency k, for splits redesigned at audio rate
+std::size_t designSplitWarped(
+    enum SplitType type, float k, struct BiquadFilterCoefficients* lp,
+    struct BiquadFilterCoefficients* hp,
+    struct BiquadFilterCoefficients* branches = nullptr);
+
+// State variable sections of both sides of a split, doubly complementary
+// splits run their cascades
+std::size_t designSplitSvf(enum SplitType type, float f, double sampleRate,
+                           struct SvfCoefficients* lp,
+                           struct SvfCoefficients* hp);
+std::size_t designSplitSvfWarped(enum SplitType type, float k,
+                                 struct SvfCoefficients* lp,
+                                 struct SvfCoefficients* hp);
+
+// Length of a linear phase split at f whose transition band is about f wide,
+// 0 if it would need more than MAX_FIR_TAPS
+int getFirSplitTaps(float f, double sampleRate);
+// Blackman windowed sinc lowpass crossing at -6dB at f, the highpass side is
+// a delay of (length - 1) / 2 samples minus the lowpass
+void designFirSplit(float f, double sampleRate, float* taps, int length);
+
+// tan(pi * f / rate) without libm, relative error under 1e-6 up to Nyquist
+float fastPrewarp(float f, float sampleRate);
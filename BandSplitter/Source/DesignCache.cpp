@@ -0,0 +1,122 @@
+#include "DesignCache.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+// Spreads nearby frequencies over the whole table, probes are bounded so
+// clusters would turn designs away long before the cache is full
+static std::size_t mix(std::uint64_t h) {
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+    return (std::size_t)(h ^ (h >> 31));
+}
+
+static std::size_t hashKey(const IirDesign::Key& key) {
+    std::uint64_t rate;
+    std::uint32_t f;
+    std::memcpy(&rate, &key.sampleRate, sizeof(rate));
+    std::memcpy(&f, &key.f, sizeof(f));
+    return mix((rate * 31 + f) * 31 + key.type);
+}
+
+static std::size_t hashKey(const FirDesign::Key& key) {
+    std::uint64_t rate;
+    std::uint32_t f;
+    std::memcpy(&rate, &key.sampleRate, sizeof(rate));
+    std::memcpy(&f, &key.f, sizeof(f));
+    return mix((rate * 31 + f) * 31 + key.taps);
+}
+
+static void design(IirDesign& design) {
+    design.sections =
+        designSplit(design.key.type, design.key.f, design.key.sampleRate,
+                    design.lp, design.hp, design.branches);
+}
+
+static void design(FirDesign& design) {
+    designFirSplit(design.key.f, design.key.sampleRate, design.fir,
+                   design.key.taps);
+}
+
+// Open addressing with linear probing, slots are only ever filled so the
+// first empty one ends the search, and publish never goes further than
+// CACHE_PROBES
+template <typename Design, int SIZE>
+static const Design* find(const std::atomic<const Design*> (&slots)[SIZE],
+                          const typename Design::Key& key) {
+    const std::size_t hash = hashKey(key);
+    for (int probe = 0; probe < CACHE_PROBES; probe++) {
+        const Design* design =
+            slots[(hash + probe) % SIZE].load(std::memory_order_acquire);
+        if (design == nullptr) return nullptr;
+        if (design->key == key) return design;
+    }
+    return nullptr;
+}
+
+template <typename Design, int SIZE>
+static const Design* publish(std::atomic<const Design*> (&slots)[SIZE],
+                             std::atomic<int>& count,
+                             const typename Design::Key& key) {
+    // Keeps the chains short, a few racing publishers may go a slot past
+    if (count.load(std::memory_order_relaxed) >=
+        SIZE * CACHE_LOAD_PERCENT / 100)
+        return nullptr;
+
+    Design* created = new Design();
+    created->key = key;
+    design(*created);
+
+    const std::size_t hash = hashKey(key);
+    for (int probe = 0; probe < CACHE_PROBES; probe++) {
+        std::atomic<const Design*>& slot = slots[(hash + probe) % SIZE];
+        const Design* existing = nullptr;
+        if (slot.compare_exchange_strong(existing, created,
+                                         std::memory_order_acq_rel)) {
+            count.fetch_add(1, std::memory_order_relaxed);
+            return created;
+        }
+        // Another instance may have published the same design meanwhile
+        if (existing->key == key) {
+            delete created;
+            return existing;
+        }
+    }
+    delete created;
+    return nullptr;
+}
+
+DesignCache::~DesignCache() {
+    for (auto& slot : iirs) delete slot.load();
+    for (auto& slot : firs) delete slot.load();
+}
+
+std::shared_ptr<DesignCache> DesignCache::acquire() {
+    static std::mutex mutex;
+    static std::weak_ptr<DesignCache> shared;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<DesignCache> cache = shared.lock();
+    if (cache == nullptr) {
+        cache = std::shared_ptr<DesignCache>(new DesignCache());
+        shared = cache;
+    }
+    return cache;
+}
+
+const IirDesign* DesignCache::findIir(const IirDesign::Key& key) const {
+    return find(iirs, key);
+}
+
+const FirDesign* DesignCache::findFir(const FirDesign::Key& key) const {
+    return find(firs, key);
+}
+
+const IirDesign* DesignCache::publishIir(const IirDesign::Key& key) {
+    return publish(iirs, iirCount, key);
+}
+
+const FirDesign* DesignCache::publishFir(const FirDesign::Key& key) {
+    return publish(firs, firCount, key);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "CrossoverDesign.hpp"
+
+// Designs the cache can hold, later ones are computed by every engine
+constexpr int IIR_CACHE_SIZE = 1024;
+constexpr int FIR_CACHE_SIZE = 256;
+// Nothing is ever evicted, so publishing stops at three quarters of the
+// slots and lookups give up after CACHE_PROBES of them. A miss costs a few
+// loads however long the process ran, a design that finds no free slot
+// among its probes is computed by every engine that needs it.
+constexpr int CACHE_PROBES = 8;
+constexpr int CACHE_LOAD_PERCENT = 75;
+
+struct IirDesign {
+    struct Key {
+        enum SplitType type;
+        double sampleRate;
+        float f;
+        bool operator==(const Key& other) const {
+            return type == other.type && sampleRate == other.sampleRate &&
+                   f == other.f;
+        }
+    } key;
+    std::size_t sections;
+    struct BiquadFilterCoefficients lp[MAX_SECTIONS], hp[MAX_SECTIONS];
+    struct BiquadFilterCoefficients branches[2];
+};
+
+struct FirDesign {
+    struct Key {
+        double sampleRate;
+        float f;
+        int taps;
+        bool operator==(const Key& other) const {
+            return sampleRate == other.sampleRate && f == other.f &&
+                   taps == other.taps;
+        }
+    } key;
+    float fir[MAX_FIR_TAPS];
+};
+
+// Split designs shared by every engine of the process. Instances loading
+// the same preset find their coefficients designed by the first one.
+// Published designs are never modified nor freed before the cache itself,
+// so lookups are lock-free and safe on the audio thread.
+class DesignCache {
+   public:
+    ~DesignCache();
+
+    // The cache lives as long as an engine holds it
+    static std::shared_ptr<DesignCache> acquire();
+
+    // Null when nobody published the design yet
+    const IirDesign* findIir(const IirDesign::Key& key) const;
+    const FirDesign* findFir(const FirDesign::Key& key) const;
+
+    // Designs and publishes, they allocate so they stay off the audio thread.
+    // Null when the cache is full or the design's slots are taken.
+    const IirDesign* publishIir(const IirDesign::Key& key);
+    const FirDesign* publishFir(const FirDesign::Key& key);
+
+   private:
+    DesignCache() = default;
+
+    std::atomic<const IirDesign*> iirs[IIR_CACHE_SIZE] = {};
+    std::atomic<const FirDesign*> firs[FIR_CACHE_SIZE] = {};
+    std::atomic<int> iirCount{0}, firCount{0};
+};
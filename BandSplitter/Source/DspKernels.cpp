@@ -0,0 +1,751 @@
+#include "DspKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "CrossoverDesign.hpp"
+
+// The reference every other kernel has to match
+static void cascadeScalar(const struct BiquadFilterCoefficients* coeffs,
+                          std::size_t sections, float* const* buffers,
+                          const State* states, int lanes, int size) {
+    for (int l = 0; l < lanes; l++)
+        BiquadFilter::processCascade(coeffs, sections, buffers[l], size,
+                                     states[l]);
+}
+
+static void svfScalar(const struct SvfCoefficients* coeffs,
+                      std::size_t sections, float* const* buffers,
+                      const State* states, int lanes, int size) {
+    for (int l = 0; l < lanes; l++)
+        BiquadFilter::processSvfCascade(coeffs, sections, buffers[l], size,
+                                        states[l]);
+}
+
+static void allpassScalar(const struct BiquadFilterCoefficients* branches,
+                          float sign, float* const* buffers,
+                          const State* states, int lanes, int size) {
+    const float a1 = branches[0].a1, a2 = branches[0].a2,
+                c = branches[1].a1, half = .5f * sign;
+    for (int l = 0; l < lanes; l++) {
+        float* buffer = buffers[l];
+        State s = states[l];
+        float x1 = s[0], x2 = s[1], u1 = s[2], u2 = s[3], v1 = s[4];
+        for (int i = 0; i < size; i++) {
+            const float xn = buffer[i];
+            // Allpass symmetry, one multiply per coefficient
+            const float un = a2 * (xn - u2) + a1 * (x1 - u1) + x2;
+            const float vn = c * (xn - v1) + x1;
+            buffer[i] = .5f * un + half * vn;
+            x2 = x1;
+            x1 = xn;
+            u2 = u1;
+            u1 = un;
+            v1 = vn;
+        }
+        s[0] = x1;
+        s[1] = x2;
+        s[2] = u1;
+        s[3] = u2;
+        s[4] = v1;
+    }
+}
+
+static void firScalar(const float* taps, int length, const float* input,
+                      float* output, int size) {
+    for (int i = 0; i < size; i++) {
+        float y = 0;
+        for (int k = 0; k < length; k++) y += taps[k] * input[i + k];
+        output[i] = y;
+    }
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DSP_DISPATCH 1
+
+// AVX-512 brings FMA along, fusing the multiplies and adds would round
+// differently from the reference
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+
+typedef float Vec4 __attribute__((vector_size(16)));
+typedef float Vec8 __attribute__((vector_size(32)));
+typedef float Vec16 __attribute__((vector_size(64)));
+
+// Same operations in the same order as BiquadFilter::processCascade, one
+// buffer per lane, so that the results are bit-identical
+template <typename Vec>
+__attribute__((always_inline)) static inline void cascadeLanes(
+    const struct BiquadFilterCoefficients* coeffs, std::size_t sections,
+    float* const* buffers, const State* states, int lanes, int size) {
+    constexpr int WIDTH = sizeof(Vec) / sizeof(float);
+    if (sections == 0) return;
+    const std::size_t stateSize = sections * 2 + 2;
+
+    for (int first = 0; first < lanes; first += WIDTH) {
+        const int count = std::min(WIDTH, lanes - first);
+        float* const* bufs = buffers + first;
+        const State* sts = states + first;
+
+        Vec s[MAX_SECTIONS * 2 + 2] = {};
+        for (std::size_t k = 0; k < stateSize; k++)
+            for (int l = 0; l < count; l++) s[k][l] = sts[l][k];
+
+        for (int i = 0; i < size; i++) {
+            Vec xn = {}, yn = {};
+            for (int l = 0; l < count; l++) xn[l] = bufs[l][i];
+            for (std::size_t j = 0; j < sections; j++) {
+                const struct BiquadFilterCoefficients& c = coeffs[j];
+                yn = c.b0 * xn + c.b1 * s[j * 2] + c.b2 * s[j * 2 + 1] -
+                     c.a1 * s[j * 2 + 2] - c.a2 * s[j * 2 + 3];
+                s[j * 2 + 1] = s[j * 2];  // x2 = x1
+                s[j * 2] = xn;            // x1 = xn
+                xn = yn;
+            }
+            s[sections * 2 + 1] = s[sections * 2];  // y2 = y1
+            s[sections * 2] = yn;                   // y1 = yn
+            for (int l = 0; l < count; l++) bufs[l][i] = yn[l];
+        }
+
+        for (std::size_t k = 0; k < stateSize; k++)
+            for (int l = 0; l < count; l++) sts[l][k] = s[k][l];
+    }
+}
+
+// Same operations in the same order as BiquadFilter::processSvfCascade
+template <typename Vec>
+__attribute__((always_inline)) static inline void svfLanes(
+    const struct SvfCoefficients* coeffs, std::size_t sections,
+    float* const* buffers, const State* states, int lanes, int size) {
+    constexpr int WIDTH = sizeof(Vec) / sizeof(float);
+    const std::size_t stateSize = sections * 2;
+
+    for (int first = 0; first < lanes; first += WIDTH) {
+        const int count = std::min(WIDTH, lanes - first);
+        float* const* bufs = buffers + first;
+        const State* sts = states + first;
+
+        Vec s[MAX_SECTIONS * 2] = {};
+        for (std::size_t k = 0; k < stateSize; k++)
+            for (int l = 0; l < count; l++) s[k][l] = sts[l][k];
+
+        for (int i = 0; i < size; i++) {
+            Vec xn = {};
+            for (int l = 0; l < count; l++) xn[l] = bufs[l][i];
+            for (std::size_t j = 0; j < sections; j++) {
+                const struct SvfCoefficients& c = coeffs[j];
+                const Vec ic1 = s[j * 2], ic2 = s[j * 2 + 1];
+                const Vec v3 = xn - ic2;
+                const Vec v1 = c.a1 * ic1 + c.a2 * v3;
+                const Vec v2 = ic2 + c.a2 * ic1 + c.a3 * v3;
+                s[j * 2] = 2 * v1 - ic1;
+                s[j * 2 + 1] = 2 * v2 - ic2;
+                xn = c.m0 * xn + c.m1 * v1 + c.m2 * v2;
+            }
+            for (int l = 0; l < count; l++) bufs[l][i] = xn[l];
+        }
+
+        for (std::size_t k = 0; k < stateSize; k++)
+            for (int l = 0; l < count; l++) sts[l][k] = s[k][l];
+    }
+}
+
+// Same operations as allpassScalar, one buffer per lane
+template <typename Vec>
+__attribute__((always_inline)) static inline void allpassLanes(
+    const struct BiquadFilterCoefficients* branches, float sign,
+    float* const* buffers, const State* states, int lanes, int size) {
+    constexpr int WIDTH = sizeof(Vec) / sizeof(float);
+    const float a1 = branches[0].a1, a2 = branches[0].a2,
+                c = branches[1].a1, half = .5f * sign;
+
+    for (int first = 0; first < lanes; first += WIDTH) {
+        const int count = std::min(WIDTH, lanes - first);
+        float* const* bufs = buffers + first;
+        const State* sts = states + first;
+
+        Vec s[5] = {};
+        for (int k = 0; k < 5; k++)
+            for (int l = 0; l < count; l++) s[k][l] = sts[l][k];
+        Vec x1 = s[0], x2 = s[1], u1 = s[2], u2 = s[3], v1 = s[4];
+
+        for (int i = 0; i < size; i++) {
+            Vec xn = {};
+            for (int l = 0; l < count; l++) xn[l] = bufs[l][i];
+            const Vec un = a2 * (xn - u2) + a1 * (x1 - u1) + x2;
+            const Vec vn = c * (xn - v1) + x1;
+            const Vec yn = .5f * un + half * vn;
+            x2 = x1;
+            x1 = xn;
+            u2 = u1;
+            u1 = un;
+            v1 = vn;
+            for (int l = 0; l < count; l++) bufs[l][i] = yn[l];
+        }
+
+        s[0] = x1;
+        s[1] = x2;
+        s[2] = u1;
+        s[3] = u2;
+        s[4] = v1;
+        for (int k = 0; k < 5; k++)
+            for (int l = 0; l < count; l++) sts[l][k] = s[k][l];
+    }
+}
+
+// WIDTH consecutive outputs at once, every one of them sums its products in
+// the same order as firScalar
+template <typename Vec>
+__attribute__((always_inline)) static inline void firLanes(
+    const float* taps, int length, const float* input, float* output,
+    int size) {
+    constexpr int WIDTH = sizeof(Vec) / sizeof(float);
+    int i = 0;
+    for (; i + WIDTH <= size; i += WIDTH) {
+        Vec y = {};
+        for (int k = 0; k < length; k++) {
+            Vec x;
+            std::memcpy(&x, input + i + k, sizeof(x));
+            y += taps[k] * x;
+        }
+        std::memcpy(output + i, &y, sizeof(y));
+    }
+    firScalar(taps, length, input + i, output + i, size - i);
+}
+
+static void cascadeSse2(const struct BiquadFilterCoefficients* coeffs,
+                        std::size_t sections, float* const* buffers,
+                        const State* states, int lanes, int size) {
+    cascadeLanes<Vec4>(coeffs, sections, buffers, states, lanes, size);
+}
+
+static void allpassSse2(const struct BiquadFilterCoefficients* branches,
+                        float sign, float* const* buffers,
+                        const State* states, int lanes, int size) {
+    allpassLanes<Vec4>(branches, sign, buffers, states, lanes, size);
+}
+
+static void firSse2(const float* taps, int length, const float* input,
+                    float* output, int size) {
+    firLanes<Vec4>(taps, length, input, output, size);
+}
+
+static void svfSse2(const struct SvfCoefficients* coeffs,
+                    std::size_t sections, float* const* buffers,
+                    const State* states, int lanes, int size) {
+    svfLanes<Vec4>(coeffs, sections, buffers, states, lanes, size);
+}
+
+__attribute__((target("avx2"))) static void cascadeAvx2(
+    const struct BiquadFilterCoefficients* coeffs, std::size_t sections,
+    float* const* buffers, const State* states, int lanes, int size) {
+    cascadeLanes<Vec8>(coeffs, sections, buffers, states, lanes, size);
+}
+
+__attribute__((target("avx2"))) static void allpassAvx2(
+    const struct BiquadFilterCoefficients* branches, float sign,
+    float* const* buffers, const State* states, int lanes, int size) {
+    allpassLanes<Vec8>(branches, sign, buffers, states, lanes, size);
+}
+
+__attribute__((target("avx2"))) static void firAvx2(const float* taps,
+                                                    int length,
+                                                    const float* input,
+                                                    float* output, int size) {
+    firLanes<Vec8>(taps, length, input, output, size);
+}
+
+__attribute__((target("avx2"))) static void svfAvx2(
+    const struct SvfCoefficients* coeffs, std::size_t sections,
+    float* const* buffers, const State* states, int lanes, int size) {
+    svfLanes<Vec8>(coeffs, sections, buffers, states, lanes, size);
+}
+
+__attribute__((target("avx512f"))) static void cascadeAvx512(
+    const struct BiquadFilterCoefficients* coeffs, std::size_t sections,
+    float* const* buffers, const State* states, int lanes, int size) {
+    cascadeLanes<Vec16>(coeffs, sections, buffers, states, lanes, size);
+}
+
+__attribute__((target("avx512f"))) static void allpassAvx512(
+    const struct BiquadFilterCoefficients* branches, float sign,
+    float* const* buffers, const State* states, int lanes, int size) {
+    allpassLanes<Vec16>(branches, sign, buffers, states, lanes, size);
+}
+
+__attribute__((target("avx512f"))) static void firAvx512(
+    const float* taps, int length, const float* input, float* output,
+    int size) {
+    firLanes<Vec16>(taps, length, input, output, size);
+}
+
+__attribute__((target("avx512f"))) static void svfAvx512(
+    const struct SvfCoefficients* coeffs, std::size_t sections,
+    float* const* buffers, const State* states, int lanes, int size) {
+    svfLanes<Vec16>(coeffs, sections, buffers, states, lanes, size);
+}
+#pragma GCC pop_options
+
+// Time-parallel cascade for when too few buffers share a split to fill the
+// registers. The DF-I state of a section is its last two inputs and
+// outputs, so WIDTH outputs at once are a linear function of that state and
+// of the WIDTH inputs: every output only waits for the previous block
+// instead of the previous sample. Low splits have their poles close to the
+// unit circle and summing those responses in float loses precision, so the
+// blocks run in double, half as many samples per register. That ends up
+// closer to the exact filter than the float recursion, but not
+// bit-identical to it.
+typedef double Vec2d __attribute__((vector_size(16)));
+typedef double Vec4d __attribute__((vector_size(32)));
+typedef double Vec8d __attribute__((vector_size(64)));
+
+template <typename Vec>
+struct BlockResponse {
+    // Responses to x1, x2, y1, y2 and to each input of the block
+    Vec x1, x2, y1, y2;
+    Vec x[sizeof(Vec) / sizeof(Vec{}[0])];
+};
+
+template <typename Vec>
+static void blockResponse(const struct BiquadFilterCoefficients& c,
+                          BlockResponse<Vec>& response) {
+    constexpr int WIDTH = sizeof(Vec) / sizeof(Vec{}[0]);
+    // Runs the recursion from a single unit value among the state (first
+    // four impulses) or the inputs (the others)
+    for (int impulse = 0; impulse < 4 + WIDTH; impulse++) {
+        double x1 = impulse == 0, x2 = impulse == 1, y1 = impulse == 2,
+               y2 = impulse == 3;
+        Vec& out = impulse == 0   ? response.x1
+                   : impulse == 1 ? response.x2
+                   : impulse == 2 ? response.y1
+                   : impulse == 3 ? response.y2
+                                  : response.x[impulse - 4];
+        for (int i = 0; i < WIDTH; i++) {
+            const double xn = impulse - 4 == i;
+            const double yn = c.b0 * xn + c.b1 * x1 + c.b2 * x2 - c.a1 * y1 -
+                              c.a2 * y2;
+            x2 = x1;
+            x1 = xn;
+            y2 = y1;
+            y1 = yn;
+            out[i] = yn;
+        }
+    }
+}
+
+template <typename Vec>
+__attribute__((always_inline)) static inline void cascadeBlocks(
+    const struct BiquadFilterCoefficients* coeffs, std::size_t sections,
+    float* const* buffers, const State* states, int lanes, int size) {
+    constexpr int WIDTH = sizeof(Vec) / sizeof(Vec{}[0]);
+    if (sections == 0) return;
+
+    BlockResponse<Vec> responses[MAX_SECTIONS];
+    for (std::size_t j = 0; j < sections; j++)
+        blockResponse(coeffs[j], responses[j]);
+
+    for (int l = 0; l < lanes; l++) {
+        float* buffer = buffers[l];
+        State s = states[l];
+        int i = 0;
+        for (; i + WIDTH <= size; i += WIDTH) {
+            Vec xn;
+            for (int k = 0; k < WIDTH; k++) xn[k] = buffer[i + k];
+            for (std::size_t j = 0; j < sections; j++) {
+                const BlockResponse<Vec>& r = responses[j];
+                Vec yn = r.x1 * s[j * 2] + r.x2 * s[j * 2 + 1] +
+                         r.y1 * s[j * 2 + 2] + r.y2 * s[j * 2 + 3];
+                for (int k = 0; k < WIDTH; k++) yn += r.x[k] * xn[k];
+                // The next section reads y1 and y2 as its own x1 and x2
+                // before overwriting them
+                s[j * 2] = xn[WIDTH - 1];
+                s[j * 2 + 1] = xn[WIDTH - 2];
+                xn = yn;
+            }
+            s[sections * 2] = xn[WIDTH - 1];
+            s[sections * 2 + 1] = xn[WIDTH - 2];
+            for (int k = 0; k < WIDTH; k++) buffer[i + k] = xn[k];
+        }
+        BiquadFilter::processCascade(coeffs, sections, buffer + i, size - i,
+                                     s);
+    }
+}
+
+// Same for an allpass split, its first order branch is a section with
+// b2 = a2 = 0 so its responses to x2 and y2 are zeros
+template <typename Vec>
+__attribute__((always_inline)) static inline void allpassBlocks(
+    const struct BiquadFilterCoefficients* branches, float sign,
+    float* const* buffers, const State* states, int lanes, int size) {
+    constexpr int WIDTH = sizeof(Vec) / sizeof(Vec{}[0]);
+    BlockResponse<Vec> u, v;
+    blockResponse(branches[0], u);
+    blockResponse(branches[1], v);
+    const double half = .5 * sign;
+
+    for (int l = 0; l < lanes; l++) {
+        float* buffer = buffers[l];
+        State s = states[l];
+        double x1 = s[0], x2 = s[1], u1 = s[2], u2 = s[3], v1 = s[4];
+        int i = 0;
+        for (; i + WIDTH <= size; i += WIDTH) {
+            Vec xn;
+            for (int k = 0; k < WIDTH; k++) xn[k] = buffer[i + k];
+            Vec un = u.x1 * x1 + u.x2 * x2 + u.y1 * u1 + u.y2 * u2;
+            Vec vn = v.x1 * x1 + v.y1 * v1;
+            for (int k = 0; k < WIDTH; k++) {
+                un += u.x[k] * xn[k];
+                vn += v.x[k] * xn[k];
+            }
+            const Vec yn = .5 * un + half * vn;
+            x1 = xn[WIDTH - 1];
+            x2 = xn[WIDTH - 2];
+            u1 = un[WIDTH - 1];
+            u2 = un[WIDTH - 2];
+            v1 = vn[WIDTH - 1];
+            for (int k = 0; k < WIDTH; k++) buffer[i + k] = yn[k];
+        }
+        s[0] = x1;
+        s[1] = x2;
+        s[2] = u1;
+        s[3] = u2;
+        s[4] = v1;
+        buffer += i;
+        allpassScalar(branches, sign, &buffer, &s, 1, size - i);
+    }
+}
+
+static void blocksSse2(const struct BiquadFilterCoefficients* coeffs,
+                       std::size_t sections, float* const* buffers,
+                       const State* states, int lanes, int size) {
+    cascadeBlocks<Vec2d>(coeffs, sections, buffers, states, lanes, size);
+}
+
+static void allpassBlocksSse2(const struct BiquadFilterCoefficients* branches,
+                              float sign, float* const* buffers,
+                              const State* states, int lanes, int size) {
+    allpassBlocks<Vec2d>(branches, sign, buffers, states, lanes, size);
+}
+
+__attribute__((target("avx2"))) static void blocksAvx2(
+    const struct BiquadFilterCoefficients* coeffs, std::size_t sections,
+    float* const* buffers, const State* states, int lanes, int size) {
+    cascadeBlocks<Vec4d>(coeffs, sections, buffers, states, lanes, size);
+}
+
+__attribute__((target("avx2"))) static void allpassBlocksAvx2(
+    const struct BiquadFilterCoefficients* branches, float sign,
+    float* const* buffers, const State* states, int lanes, int size) {
+    allpassBlocks<Vec4d>(branches, sign, buffers, states, lanes, size);
+}
+
+__attribute__((target("avx512f"))) static void blocksAvx512(
+    const struct BiquadFilterCoefficients* coeffs, std::size_t sections,
+    float* const* buffers, const State* states, int lanes, int size) {
+    cascadeBlocks<Vec8d>(coeffs, sections, buffers, states, lanes, size);
+}
+
+__attribute__((target("avx512f"))) static void allpassBlocksAvx512(
+    const struct BiquadFilterCoefficients* branches, float sign,
+    float* const* buffers, const State* states, int lanes, int size) {
+    allpassBlocks<Vec8d>(branches, sign, buffers, states, lanes, size);
+}
+#endif
+
+struct Candidate {
+    struct DspKernel kernel;
+    // Whether the running CPU can execute it
+    bool (*supported)();
+};
+
+static const struct Candidate CANDIDATES[] = {
+#if DSP_DISPATCH
+    {{"avx512", 16, cascadeAvx512, blocksAvx512, allpassAvx512,
+      allpassBlocksAvx512, firAvx512, svfAvx512},
+     []() -> bool { return __builtin_cpu_supports("avx512f"); }},
+    {{"avx2", 8, cascadeAvx2, blocksAvx2, allpassAvx2, allpassBlocksAvx2,
+      firAvx2, svfAvx2},
+     []() -> bool { return __builtin_cpu_supports("avx2"); }},
+    {{"sse2", 4, cascadeSse2, blocksSse2, allpassSse2, allpassBlocksSse2,
+      firSse2, svfSse2},
+     []() -> bool { return __builtin_cpu_supports("sse2"); }},
+#endif
+    {{"scalar", 1, cascadeScalar, cascadeScalar, allpassScalar, allpassScalar,
+      firScalar, svfScalar},
+     []() -> bool { return true; }}};
+
+// Runs noise through a linear phase split of an uneven length and block size
+static bool firMatchesReference(const struct DspKernel& kernel) {
+    constexpr int TAPS = 63, SIZE = 257;
+    float taps[TAPS], input[TAPS - 1 + SIZE], expected[SIZE], actual[SIZE];
+    designFirSplit(3000, 48000, taps, TAPS);
+
+    unsigned int seed = 1;
+    for (float& x : input) {
+        seed = seed * 1664525 + 1013904223;
+        x = (int)(seed >> 8) / 8388608.f - 1;
+    }
+    firScalar(taps, TAPS, input, expected, SIZE);
+    kernel.fir(taps, TAPS, input, actual, SIZE);
+    return std::memcmp(expected, actual, sizeof(expected)) == 0;
+}
+
+// One step of a direct form I section in double, z holds x1, x2, y1, y2
+static double exactSection(const struct BiquadFilterCoefficients& c,
+                           double* z, double xn) {
+    const double yn =
+        c.b0 * xn + c.b1 * z[0] + c.b2 * z[1] - c.a1 * z[2] - c.a2 * z[3];
+    z[1] = z[0];
+    z[0] = xn;
+    z[3] = z[2];
+    z[2] = yn;
+    return yn;
+}
+
+// The blocks round differently from the recursion, they can't match it bit
+// for bit. Both are held to the same split run in double instead: on low
+// highpass sides the float reference is itself far from it (4e-4 at 20 Hz),
+// so a fixed tolerance against the reference would turn down blocks that
+// are more accurate than it. The blocks may be twice as far as the
+// reference, plus a few roundings of a full scale sample. Runs two lanes
+// over two uneven blocks on both sides of a low and a middle split, for the
+// cascade then for an allpass split.
+static bool blocksMatchReference(const struct DspKernel& kernel) {
+    constexpr int LANES = 2, SIZE = 257;
+    constexpr std::size_t STATE_SIZE = MAX_SECTIONS * 2 + 2;
+    static const float FREQUENCIES[] = {20, 1000};
+
+    float expected[LANES][SIZE], actual[LANES][SIZE];
+    float expectedStates[LANES][STATE_SIZE], actualStates[LANES][STATE_SIZE];
+    double exact[LANES][SIZE], exactStates[LANES][MAX_SECTIONS][4];
+    float *expectedBuffers[LANES], *actualBuffers[LANES];
+    State expectedStatePtrs[LANES], actualStatePtrs[LANES];
+    for (int l = 0; l < LANES; l++) {
+        expectedBuffers[l] = expected[l];
+        actualBuffers[l] = actual[l];
+        expectedStatePtrs[l] = expectedStates[l];
+        actualStatePtrs[l] = actualStates[l];
+    }
+
+    unsigned int seed = 1;
+    for (const float f : FREQUENCIES) {
+        for (const enum SplitType type : {BUTTERWORTH8, ALLPASS3}) {
+            struct BiquadFilterCoefficients lp[MAX_SECTIONS],
+                hp[MAX_SECTIONS], branches[2];
+            const std::size_t sections =
+                designSplit(type, f, 48000, lp, hp, branches);
+            const bool allpass = type == ALLPASS3;
+            for (int side = 0; side < 2; side++) {
+                const struct BiquadFilterCoefficients* coeffs =
+                    side == 0 ? lp : hp;
+                const float sign = side == 0 ? 1 : -1;
+                std::memset(expectedStates, 0, sizeof(expectedStates));
+                std::memset(actualStates, 0, sizeof(actualStates));
+                std::memset(exactStates, 0, sizeof(exactStates));
+                double referenceError = 0, kernelError = 0;
+                for (int block = 0; block < 2; block++) {
+                    for (int l = 0; l < LANES; l++) {
+                        for (int i = 0; i < SIZE; i++) {
+                            seed = seed * 1664525 + 1013904223;
+                            expected[l][i] = actual[l][i] =
+                                (int)(seed >> 8) / 8388608.f - 1;
+                            double x = expected[l][i];
+                            if (allpass) {
+                                x = .5 * (exactSection(branches[0],
+                                                       exactStates[l][0], x) +
+                                          sign * exactSection(
+                                                     branches[1],
+                                                     exactStates[l][1], x));
+                            } else {
+                                for (std::size_t j = 0; j < sections; j++)
+                                    x = exactSection(coeffs[j],
+                                                     exactStates[l][j], x);
+                            }
+                            exact[l][i] = x;
+                        }
+                    }
+                    if (allpass) {
+                        allpassScalar(branches, sign, expectedBuffers,
+                                      expectedStatePtrs, LANES, SIZE);
+                        kernel.allpassBlocks(branches, sign, actualBuffers,
+                                             actualStatePtrs, LANES, SIZE);
+                    } else {
+                        cascadeScalar(coeffs, sections, expectedBuffers,
+                                      expectedStatePtrs, LANES, SIZE);
+                        kernel.blocks(coeffs, sections, actualBuffers,
+                                      actualStatePtrs, LANES, SIZE);
+                    }
+                    for (int l = 0; l < LANES; l++) {
+                        for (int i = 0; i < SIZE; i++) {
+                            const double x = exact[l][i];
+                            referenceError = std::max(
+                                referenceError, std::fabs(expected[l][i] - x));
+                            kernelError = std::max(kernelError,
+                                                   std::fabs(actual[l][i] - x));
+                        }
+                    }
+                }
+                if (!(kernelError <= 2 * referenceError + 1e-6)) return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Runs noise through both sides of an allpass split on an uneven number of
+// lanes, over two blocks
+static bool allpassMatchesReference(const struct DspKernel& kernel) {
+    constexpr int LANES = MAX_LANES - 3, SIZE = 257;
+    constexpr std::size_t STATE_SIZE = MAX_SECTIONS * 2 + 2;
+
+    struct BiquadFilterCoefficients lp[MAX_SECTIONS], hp[MAX_SECTIONS],
+        branches[2];
+    designSplit(ALLPASS3, 1000, 48000, lp, hp, branches);
+
+    static float expected[LANES][SIZE], actual[LANES][SIZE];
+    float expectedStates[LANES][STATE_SIZE] = {},
+          actualStates[LANES][STATE_SIZE] = {};
+    float *expectedBuffers[LANES], *actualBuffers[LANES];
+    State expectedStatePtrs[LANES], actualStatePtrs[LANES];
+    for (int l = 0; l < LANES; l++) {
+        expectedBuffers[l] = expected[l];
+        actualBuffers[l] = actual[l];
+        expectedStatePtrs[l] = expectedStates[l];
+        actualStatePtrs[l] = actualStates[l];
+    }
+
+    unsigned int seed = 1;
+    for (int block = 0; block < 2; block++) {
+        for (int l = 0; l < LANES; l++) {
+            for (int i = 0; i < SIZE; i++) {
+                seed = seed * 1664525 + 1013904223;
+                expected[l][i] = actual[l][i] = (int)(seed >> 8) / 8388608.f - 1;
+            }
+        }
+        const float sign = block == 0 ? 1 : -1;
+        allpassScalar(branches, sign, expectedBuffers, expectedStatePtrs,
+                      LANES, SIZE);
+        kernel.allpass(branches, sign, actualBuffers, actualStatePtrs, LANES,
+                       SIZE);
+        if (std::memcmp(expected, actual, sizeof(expected)) != 0 ||
+            std::memcmp(expectedStates, actualStates,
+                        sizeof(expectedStates)) != 0)
+            return false;
+    }
+    return true;
+}
+
+// Runs noise through both sides of an allpass split as state variable
+// cascades, first and second order sections, on an uneven number of lanes
+static bool svfMatchesReference(const struct DspKernel& kernel) {
+    constexpr int LANES = MAX_LANES - 3, SIZE = 257;
+    constexpr std::size_t STATE_SIZE = MAX_SECTIONS * 2 + 2;
+
+    struct SvfCoefficients lp[MAX_SECTIONS], hp[MAX_SECTIONS];
+    const std::size_t sections = designSplitSvf(ALLPASS3, 1000, 48000, lp, hp);
+
+    static float expected[LANES][SIZE], actual[LANES][SIZE];
+    float expectedStates[LANES][STATE_SIZE] = {},
+          actualStates[LANES][STATE_SIZE] = {};
+    float *expectedBuffers[LANES], *actualBuffers[LANES];
+    State expectedStatePtrs[LANES], actualStatePtrs[LANES];
+    for (int l = 0; l < LANES; l++) {
+        expectedBuffers[l] = expected[l];
+        actualBuffers[l] = actual[l];
+        expectedStatePtrs[l] = expectedStates[l];
+        actualStatePtrs[l] = actualStates[l];
+    }
+
+    unsigned int seed = 1;
+    for (int block = 0; block < 2; block++) {
+        for (int l = 0; l < LANES; l++) {
+            for (int i = 0; i < SIZE; i++) {
+                seed = seed * 1664525 + 1013904223;
+                expected[l][i] = actual[l][i] = (int)(seed >> 8) / 8388608.f - 1;
+            }
+        }
+        const struct SvfCoefficients* coeffs = block == 0 ? lp : hp;
+        svfScalar(coeffs, sections, expectedBuffers, expectedStatePtrs, LANES,
+                  SIZE);
+        kernel.svf(coeffs, sections, actualBuffers, actualStatePtrs, LANES,
+                   SIZE);
+        if (std::memcmp(expected, actual, sizeof(expected)) != 0 ||
+            std::memcmp(expectedStates, actualStates,
+                        sizeof(expectedStates)) != 0)
+            return false;
+    }
+    return true;
+}
+
+// Runs noise through an eighth order split on an uneven number of lanes,
+// over two blocks to check that the states are carried over
+static bool matchesReference(const struct DspKernel& kernel) {
+    if (!firMatchesReference(kernel) || !blocksMatchReference(kernel) ||
+        !allpassMatchesReference(kernel) || !svfMatchesReference(kernel))
+        return false;
+
+    constexpr int LANES = MAX_LANES - 3, SIZE = 257;
+    constexpr std::size_t STATE_SIZE = MAX_SECTIONS * 2 + 2;
+
+    struct BiquadFilterCoefficients lp[MAX_SECTIONS], hp[MAX_SECTIONS];
+    const std::size_t sections = designSplit(BUTTERWORTH8, 1000, 48000, lp, hp);
+
+    static float expected[LANES][SIZE], actual[LANES][SIZE];
+    float expectedStates[LANES][STATE_SIZE] = {},
+          actualStates[LANES][STATE_SIZE] = {};
+    float *expectedBuffers[LANES], *actualBuffers[LANES];
+    State expectedStatePtrs[LANES], actualStatePtrs[LANES];
+    for (int l = 0; l < LANES; l++) {
+        expectedBuffers[l] = expected[l];
+        actualBuffers[l] = actual[l];
+        expectedStatePtrs[l] = expectedStates[l];
+        actualStatePtrs[l] = actualStates[l];
+    }
+
+    unsigned int seed = 1;
+    for (int block = 0; block < 2; block++) {
+        for (int l = 0; l < LANES; l++) {
+            for (int i = 0; i < SIZE; i++) {
+                seed = seed * 1664525 + 1013904223;
+                expected[l][i] = actual[l][i] = (int)(seed >> 8) / 8388608.f - 1;
+            }
+        }
+        cascadeScalar(lp, sections, expectedBuffers, expectedStatePtrs, LANES,
+                      SIZE);
+        kernel.cascade(lp, sections, actualBuffers, actualStatePtrs, LANES,
+                       SIZE);
+        if (std::memcmp(expected, actual, sizeof(expected)) != 0 ||
+            std::memcmp(expectedStates, actualStates,
+                        sizeof(expectedStates)) != 0)
+            return false;
+    }
+    return true;
+}
+
+static const struct DspKernel& selectKernel() {
+    for (const struct Candidate& candidate : CANDIDATES) {
+        if (candidate.supported() && matchesReference(candidate.kernel))
+            return candidate.kernel;
+    }
+    return CANDIDATES[sizeof(CANDIDATES) / sizeof(*CANDIDATES) - 1].kernel;
+}
+
+int getSupportedDspKernels(const struct DspKernel** kernels, int capacity) {
+    int count = 0;
+    for (const struct Candidate& candidate : CANDIDATES) {
+        if (!candidate.supported()) continue;
+        if (count < capacity) kernels[count] = &candidate.kernel;
+        count++;
+    }
+    return count;
+}
+
+const struct DspKernel& getReferenceDspKernel() {
+    return CANDIDATES[sizeof(CANDIDATES) / sizeof(*CANDIDATES) - 1].kernel;
+}
+
+const struct DspKernel& getDspKernel() {
+    static const struct DspKernel& kernel = selectKernel();
+    return kernel;
+}
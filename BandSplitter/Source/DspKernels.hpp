@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+
+#include "BiquadFilter.hpp"
+
+// Most buffers a kernel runs at once, every band channel of a split
+constexpr int MAX_LANES = 16;
+
+// Runs the same normalized cascade over several buffers, each with its own
+// state (laid out like BiquadFilter::processCascade's)
+typedef void (*CascadeKernel)(const struct BiquadFilterCoefficients* coeffs,
+                              std::size_t sections, float* const* buffers,
+                              const State* states, int lanes, int size);
+
+// Same for a cascade of state variable sections, laid out like
+// BiquadFilter::processSvfCascade's states
+typedef void (*SvfKernel)(const struct SvfCoefficients* coeffs,
+                          std::size_t sections, float* const* buffers,
+                          const State* states, int lanes, int size);
+
+// Half sum (sign = 1) or half difference (sign = -1) of a second order
+// allpass branch (b0 = a2, b1 = a1, b2 = 1) and a first order one (b0 = a1),
+// both fed by the same input. The states hold x1, x2, the two last outputs
+// of the second order branch then the last output of the first order one.
+typedef void (*AllpassKernel)(const struct BiquadFilterCoefficients* branches,
+                              float sign, float* const* buffers,
+                              const State* states, int lanes, int size);
+
+// Direct convolution, output[i] = sum(taps[k] * input[i + k]) so input holds
+// length - 1 samples of history before the size samples of the block
+typedef void (*FirKernel)(const float* taps, int length, const float* input,
+                          float* output, int size);
+
+struct DspKernel {
+    const char* name;
+    // Buffers (or samples for the FIR) processed side by side in SIMD
+    // registers
+    int width;
+    CascadeKernel cascade;
+    // Same filtering with each buffer cut in blocks of consecutive samples
+    // instead, faster when there are no more than width / 2 buffers. Close
+    // to the reference but not bit-identical, so the engine only uses it
+    // when its output may depend on the block size.
+    CascadeKernel blocks;
+    AllpassKernel allpass;
+    // The allpass split in blocks of samples, like blocks
+    AllpassKernel allpassBlocks;
+    FirKernel fir;
+    SvfKernel svf;
+};
+
+// Fastest kernel the CPU supports among the ones that give the same output
+// as the scalar reference, picked on first use
+const struct DspKernel& getDspKernel();
+
+// Every kernel the running CPU can execute, fastest first, whether it matches
+// the reference or not, for the tests. Writes up to capacity of them and
+// returns how many there are.
+int getSupportedDspKernels(const struct DspKernel** kernels, int capacity);
+// The scalar kernel every other one is compared against
+const struct DspKernel& getReferenceDspKernel();
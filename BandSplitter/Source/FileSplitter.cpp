@@ -0,0 +1,142 @@
+#include "FileSplitter.hpp"
+
+// Gives the engine back for real time use however split returns
+struct OfflineRender {
+    explicit OfflineRender(SplitterEngine& engine) : engine(engine) {
+        engine.setIdleDetection(false);
+        engine.setBitExact(true);
+    }
+    ~OfflineRender() {
+        engine.setIdleDetection(true);
+        engine.setBitExact(false);
+    }
+    SplitterEngine& engine;
+};
+
+FileSplitter::FileSplitter(SplitterEngine& engine) : engine(engine) {
+    formats.registerBasicFormats();
+}
+
+std::unique_ptr<juce::AudioFormatReader> FileSplitter::openInput(
+    const juce::File& input, juce::AudioFormat*& format) {
+    format = formats.findFormatForFileExtension(input.getFileExtension());
+    if (format != nullptr) {
+        std::unique_ptr<juce::AudioFormatReader> reader(
+            format->createMemoryMappedReader(input));
+        if (reader != nullptr) return reader;
+    }
+
+    // Compressed formats can't be mapped, they are streamed instead
+    std::unique_ptr<juce::AudioFormatReader> reader(
+        formats.createReaderFor(input));
+    for (int i = 0; reader != nullptr && format == nullptr &&
+                    i < formats.getNumKnownFormats();
+         i++) {
+        if (formats.getKnownFormat(i)->getFormatName() ==
+            reader->getFormatName())
+            format = formats.getKnownFormat(i);
+    }
+    return reader;
+}
+
+juce::Result FileSplitter::split(const juce::File& input,
+                                 const juce::Array<juce::File>& outputs) {
+    juce::AudioFormat* format = nullptr;
+    std::unique_ptr<juce::AudioFormatReader> reader =
+        openInput(input, format);
+    if (reader == nullptr || format == nullptr)
+        return juce::Result::fail("Can't read " + input.getFullPathName());
+
+    const int channels = (int)reader->numChannels;
+    const int n = engine.getBands();
+    if (channels < 1 || channels > MAX_CHANNELS)
+        return juce::Result::fail("Only mono and stereo files can be split");
+    if (outputs.size() != n)
+        return juce::Result::fail("Expected " + juce::String(n) +
+                                  " output files");
+
+    auto* mapped =
+        dynamic_cast<juce::MemoryMappedAudioFormatReader*>(reader.get());
+
+    // Every band gets its own thread so that a slow disk doesn't hold the
+    // others back, the fifos hold two chunks so that disk writes overlap
+    // with the next chunk
+    juce::OwnedArray<juce::TimeSliceThread> threads;
+    std::vector<std::unique_ptr<juce::AudioFormatWriter::ThreadedWriter>>
+        writers;
+    for (int j = 0; j < n; j++) {
+        outputs[j].deleteFile();
+        std::unique_ptr<juce::OutputStream> stream =
+            outputs[j].createOutputStream();
+        if (stream == nullptr)
+            return juce::Result::fail("Can't write " +
+                                      outputs[j].getFullPathName());
+
+        std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(
+            stream.get(), reader->sampleRate, (unsigned int)channels,
+            (int)reader->bitsPerSample, reader->metadataValues, 0));
+        if (writer == nullptr)
+            return juce::Result::fail("Can't write " +
+                                      outputs[j].getFullPathName());
+        stream.release();
+
+        auto* thread = threads.add(new juce::TimeSliceThread(
+            "Band " + juce::String(j + 1) + " writer"));
+        thread->startThread();
+        writers.push_back(
+            std::make_unique<juce::AudioFormatWriter::ThreadedWriter>(
+                writer.release(), *thread, FILE_CHUNK_SIZE * 2));
+    }
+
+    // Tails below the silence level and the blocks kernels would depend on
+    // where chunks start
+    const OfflineRender offline(engine);
+    engine.prepare(reader->sampleRate);
+
+    juce::AudioBuffer<float> in(channels, FILE_CHUNK_SIZE);
+    juce::AudioBuffer<float> bands(n * channels, FILE_CHUNK_SIZE);
+    float* bandOutputs[MAX_BANDS * MAX_CHANNELS] = {};
+    for (int i = 0; i < n * channels; i++)
+        bandOutputs[i] = bands.getWritePointer(i);
+
+    // Linear phase splits delay every band, the first latency samples are
+    // dropped and the input is padded to get its end out
+    const int latency = engine.getLatencySamples();
+    int skip = latency;
+
+    const juce::int64 length = reader->lengthInSamples;
+    for (juce::int64 pos = 0; pos < length + latency; pos += FILE_CHUNK_SIZE) {
+        const int samples = (int)std::min((juce::int64)FILE_CHUNK_SIZE,
+                                          length + latency - pos);
+        const int available =
+            (int)std::clamp(length - pos, (juce::int64)0, (juce::int64)samples);
+
+        // Only the current chunk is mapped, the address space and resident
+        // memory stay bounded whatever the length of the file
+        if (mapped != nullptr && available > 0 &&
+            !mapped->mapSectionOfFile({pos, pos + available}))
+            return juce::Result::fail("Can't map " + input.getFullPathName());
+        if (available > 0 && !reader->read(&in, 0, available, pos, true, true))
+            return juce::Result::fail("Can't read " + input.getFullPathName());
+        if (available < samples) in.clear(available, samples - available);
+
+        engine.process(in.getArrayOfReadPointers(), channels, bandOutputs,
+                       samples);
+
+        const int skipped = std::min(skip, samples);
+        skip -= skipped;
+        for (int j = 0; j < n; j++) {
+            const float* data[MAX_CHANNELS] = {};
+            for (int c = 0; c < channels; c++)
+                data[c] = bands.getReadPointer(j * channels + c, skipped);
+            // The fifo is full while the disk catches up
+            while (!writers[j]->write(data, samples - skipped))
+                juce::Thread::sleep(1);
+        }
+    }
+
+    // Flushes the fifos and closes the files
+    writers.clear();
+    for (auto* thread : threads) thread->stopThread(-1);
+    return juce::Result::ok();
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "SplitterEngine.hpp"
+
+// Samples read from the input between two engine calls
+constexpr int FILE_CHUNK_SIZE = 1 << 16;
+
+// Splits audio files of any length into one file per band with a bounded
+// amount of memory. WAV and AIFF inputs are memory mapped one chunk at a
+// time and every band is written by its own background thread.
+class FileSplitter {
+   public:
+    // The engine has to be set up (bands, splits, gains...) beforehand
+    explicit FileSplitter(SplitterEngine& engine);
+
+    // outputs holds one file per band, they are written in the format of the
+    // input. The result doesn't depend on the chunk size.
+    juce::Result split(const juce::File& input,
+                       const juce::Array<juce::File>& outputs);
+
+   private:
+    std::unique_ptr<juce::AudioFormatReader> openInput(
+        const juce::File& input, juce::AudioFormat*& format);
+
+    SplitterEngine& engine;
+    juce::AudioFormatManager formats;
+};
@@ -32,7 +32,14 @@ void ParamListener::sliderDragEnded(juce::Slider* s) {
 void ParamListener::parameterValueChanged(int parameterIndex, float newValue) {
     (void)parameterIndex;
     (void)newValue;
-    slider.setValue(param->convertFrom0to1(param->getValue()));
+    dirty = true;
+}
+
+void ParamListener::refresh() {
+    // The slider only repaints when its value really changes
+    if (dirty.exchange(false))
+        slider.setValue(param->convertFrom0to1(param->getValue()),
+                        juce::dontSendNotification);
 }
 
 void ParamListener::parameterGestureChanged(int parameterIndex,
@@ -50,7 +57,7 @@ KnobComponent::KnobComponent(juce::RangedAudioParameter* param, double step)
     label.attachToComponent(&knob, false);
     label.setJustificationType(juce::Justification::centred);
 
-    knob.setLookAndFeel(&lf);
+    knob.setLookAndFeel(&lf.get());
     knob.setColour(juce::Slider::thumbColourId, juce::Colours::grey.brighter());
     knob.setSliderStyle(juce::Slider::SliderStyle::Rotary);
     knob.setTextBoxStyle(juce::Slider::TextBoxAbove, false, 100, 20);
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <JuceHeader.h>
+
+#include <atomic>
+
 #include "Looknfeel.hpp"
 
 class ParamListener : public juce::Slider::Listener,
@@ -21,9 +24,15 @@ class ParamListener : public juce::Slider::Listener,
     void parameterGestureChanged(int parameterIndex,
                                  bool gestureIsStarting) override;
 
+    // Moves the slider to the last value of the parameter if it changed,
+    // called by the editor's timer on the message thread
+    void refresh();
+
    private:
     juce::RangedAudioParameter* param;
     juce::Slider& slider;
+    // Host automation may come from any thread and many times per frame
+    std::atomic<bool> dirty{false};
 };
 
 class KnobComponent : public juce::Component {
@@ -36,11 +45,13 @@ class KnobComponent : public juce::Component {
     void resized() override;
 
     double getValue() const;
+    inline void refresh() { paramListener.refresh(); }
 
    private:
     juce::Slider knob;
     juce::Label label;
-    Looknfeel lf;
+    // One look and feel for every knob of the process
+    juce::SharedResourcePointer<Looknfeel> lf;
 
     ParamListener paramListener;
 };
\ No newline at end of file
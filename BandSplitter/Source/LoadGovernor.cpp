@@ -0,0 +1,66 @@
+#include "LoadGovernor.hpp"
+
+#include <cmath>
+
+void LoadGovernor::setBudget(float budget) { this->budget = budget; }
+
+void LoadGovernor::update(double seconds, int samples, double sampleRate) {
+    if (samples <= 0 || sampleRate <= 0) return;
+    const double deadline = samples / sampleRate;
+    const float measured = (float)(seconds / deadline);
+
+    float current = load.load(std::memory_order_relaxed);
+    if (measured > current)
+        current = measured;
+    else
+        current += (float)(1 - std::exp(-deadline / GOVERNOR_RELEASE_SECONDS)) *
+                   (measured - current);
+    load.store(current, std::memory_order_relaxed);
+    hold -= deadline;
+
+    int l = level.load(std::memory_order_relaxed);
+    if (budget <= 0) {
+        level.store(GOVERNOR_FULL, std::memory_order_relaxed);
+        recover = 0;
+        return;
+    }
+
+    if (current > budget) {
+        recover = 0;
+        if (hold > 0 || l == GOVERNOR_LEVELS - 1) return;
+        l++;
+    } else if (current < budget * GOVERNOR_RECOVER_RATIO && l > 0) {
+        recover += deadline;
+        if (recover < GOVERNOR_RECOVER_SECONDS) return;
+        l--;
+    } else {
+        recover = 0;
+        return;
+    }
+
+    // The load of the old level says nothing about the new one
+    level.store(l, std::memory_order_relaxed);
+    load.store(0, std::memory_order_relaxed);
+    hold = GOVERNOR_HOLD_SECONDS;
+    recover = 0;
+}
+
+const char* LoadGovernor::getLevelName(int level) {
+    switch (level) {
+        case GOVERNOR_NO_LINEAR_PHASE:
+            return "no linear phase";
+        case GOVERNOR_CHEAPER_SPLITS:
+            return "cheaper splits";
+        case GOVERNOR_STATIC_SPLITS:
+            return "static splits";
+        default:
+            return "full";
+    }
+}
+
+enum SplitType LoadGovernor::degradeType(enum SplitType type, int level) {
+    if (level < GOVERNOR_CHEAPER_SPLITS) return type;
+    // Butterworth keeps its shape at half the order, the other fourth
+    // order types give way to the third order allpass split
+    return type == BUTTERWORTH8 ? BUTTERWORTH4 : ALLPASS3;
+}
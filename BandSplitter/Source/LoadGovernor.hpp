@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+
+#include "CrossoverDesign.hpp"
+
+// Share of the budget under which the load has to stay before the governor
+// steps back up, and for how long
+constexpr float GOVERNOR_RECOVER_RATIO = .7f;
+constexpr double GOVERNOR_RECOVER_SECONDS = 2;
+// Time a new level is given to show its effect before stepping again
+constexpr double GOVERNOR_HOLD_SECONDS = .1;
+// Release of the measured load, its peaks are taken at once
+constexpr double GOVERNOR_RELEASE_SECONDS = .5;
+
+// What the processing gives up, each level keeps the ones before
+enum GovernorLevel {
+    GOVERNOR_FULL,
+    // Linear phase splits go back to IIR
+    GOVERNOR_NO_LINEAR_PHASE,
+    // Splits use a type of lower order
+    GOVERNOR_CHEAPER_SPLITS,
+    // Splits stop being modulated and the bands aren't time-aligned
+    GOVERNOR_STATIC_SPLITS
+};
+constexpr int GOVERNOR_LEVELS = 4;
+
+// Watches the time the blocks take against their real time deadline and
+// trades quality for headroom when it nears the budget, a lost crossover
+// slope being better than a dropout. Without any JUCE dependency.
+class LoadGovernor {
+   public:
+    // Share of the deadline the processing may take, 0 turns it off
+    void setBudget(float budget);
+
+    // Audio thread, with the time the last block of samples took
+    void update(double seconds, int samples, double sampleRate);
+
+    // Read from any thread, for the editor
+    inline int getLevel() const { return level.load(); }
+    inline float getLoad() const { return load.load(); }
+    static const char* getLevelName(int level);
+
+    // Split type that runs in place of type at a level
+    static enum SplitType degradeType(enum SplitType type, int level);
+
+   private:
+    float budget = 0;
+    std::atomic<int> level{GOVERNOR_FULL};
+    std::atomic<float> load{0};
+    double hold = 0, recover = 0;
+};
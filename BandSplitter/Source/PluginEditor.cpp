@@ -9,36 +9,82 @@ BandSplitterAudioProcessorEditor::BandSplitterAudioProcessorEditor(
       addBand("ADD"),
       removeBand("REMOVE"),
       bands("bands", "Bands : " + std::to_string(*p.getBandParam())),
+      kernel("kernel", juce::String("DSP : ") + p.getKernelName()),
+      load("load", "CPU : 0%"),
+      program(p.getProgramName(p.getCurrentProgram())),
       listener(p.getBandParam(), bands) {
     juce::AudioParameterInt* bandParam = p.getBandParam();
-    int b = *bandParam;
-    for (int i = 0; i < MAX_BANDS - 1; i++) {
-        this->splits[i].emplace(p.getFreqParam(i));
-        this->addAndMakeVisible(*this->splits[i]);
-        if (b < i + 2) this->splits[i]->setVisible(false);
-    }
+    for (int j = 0; j < *bandParam; j++) this->setBandVisible(j, true);
 
     this->addAndMakeVisible(addBand);
     this->addAndMakeVisible(removeBand);
     this->addAndMakeVisible(bands);
+    this->addAndMakeVisible(kernel);
+    this->addAndMakeVisible(load);
+    this->addAndMakeVisible(program);
 
     bands.setJustificationType(juce::Justification::centred);
+    kernel.setJustificationType(juce::Justification::centred);
+    load.setJustificationType(juce::Justification::centred);
 
     addBand.onClick = [=]() {
         int val = *bandParam + 1;
         bandParam->setValueNotifyingHost(bandParam->convertTo0to1(val));
-        if (val < MAX_BANDS + 1) splits[val - 2]->setVisible(true);
+        if (val < MAX_BANDS + 1) setBandVisible(val - 1, true);
     };
+    program.onClick = [this]() { showProgramMenu(); };
     removeBand.onClick = [=]() {
         int val = *bandParam - 1;
         bandParam->setValueNotifyingHost(bandParam->convertTo0to1(val));
-        if (val > 1) splits[val - 1]->setVisible(false);
+        if (val > 1) setBandVisible(val, false);
     };
 
     setSize(800, 500);
+    startTimerHz(EDITOR_REFRESH_HZ);
+}
+
+BandSplitterAudioProcessorEditor::~BandSplitterAudioProcessorEditor() {
+    stopTimer();
 }
 
-BandSplitterAudioProcessorEditor::~BandSplitterAudioProcessorEditor() {}
+void BandSplitterAudioProcessorEditor::timerCallback() {
+    listener.refresh();
+    // Programs and automation change the band count behind the buttons
+    const int n = *audioProcessor.getBandParam();
+    for (int j = 0; j < MAX_BANDS; j++) {
+        const bool visible = gains[j] && gains[j]->isVisible();
+        if (visible != (j < n)) setBandVisible(j, j < n);
+    }
+    for (auto& split : splits)
+        if (split) split->refresh();
+    for (auto& gain : gains)
+        if (gain) gain->refresh();
+    // The governor steps down under load, shown with the level it's at
+    const LoadGovernor& governor = audioProcessor.getGovernor();
+    juce::String text =
+        "CPU : " + juce::String(juce::roundToInt(governor.getLoad() * 100)) +
+        "%";
+    if (governor.getLevel() != GOVERNOR_FULL)
+        text += " (" +
+                juce::String(LoadGovernor::getLevelName(governor.getLevel())) +
+                ")";
+    load.setText(text, juce::NotificationType::dontSendNotification);
+
+    // Hosts switch programs too
+    const juce::String name =
+        audioProcessor.getProgramName(audioProcessor.getCurrentProgram());
+    if (program.getButtonText() != name) program.setButtonText(name);
+
+    for (int j = 0; j < MAX_BANDS; j++) {
+        if (!effects[j]) continue;
+        // Shows how many plugins the band runs
+        const int count = audioProcessor.getChains().getPluginCount(j);
+        const juce::String text =
+            count > 0 ? "FX " + juce::String(count) : juce::String("FX");
+        if (effects[j]->getButtonText() != text)
+            effects[j]->setButtonText(text);
+    }
+}
 
 void BandSplitterAudioProcessorEditor::paint(juce::Graphics& g) {
     g.fillAll(juce::Colours::black);
@@ -48,10 +94,117 @@ void BandSplitterAudioProcessorEditor::resized() {
     addBand.setBounds(0, 0, 100, 50);
     removeBand.setBounds(100, 0, 100, 50);
     bands.setBounds(200, 0, 100, 50);
-    for (int i = 0; i < MAX_BANDS - 1; i++) {
+    kernel.setBounds(300, 0, 100, 50);
+    load.setBounds(400, 0, 200, 50);
+    program.setBounds(600, 0, 200, 50);
+    for (int j = 0; j < MAX_BANDS; j++) this->layoutBand(j);
+}
+
+void BandSplitterAudioProcessorEditor::setBandVisible(int band,
+                                                      bool visible) {
+    if (visible && !this->gains[band]) {
+        this->gains[band].emplace(audioProcessor.getGainParam(band), .1);
+        this->addChildComponent(*this->gains[band]);
+        if (band > 0) {
+            this->splits[band - 1].emplace(
+                audioProcessor.getFreqParam(band - 1));
+            this->addChildComponent(*this->splits[band - 1]);
+        }
+        this->effects[band].emplace("FX");
+        this->effects[band]->onClick = [=]() { showChainMenu(band); };
+        this->addChildComponent(*this->effects[band]);
+        this->layoutBand(band);
+    }
+    if (this->gains[band]) this->gains[band]->setVisible(visible);
+    if (this->effects[band]) this->effects[band]->setVisible(visible);
+    if (band > 0 && this->splits[band - 1])
+        this->splits[band - 1]->setVisible(visible);
+}
+
+void BandSplitterAudioProcessorEditor::layoutBand(int band) {
+    if (this->gains[band])
+        this->gains[band]->setBounds((band % 8) * 100, 250 + (band / 8) * 100,
+                                     100, 100);
+    if (this->effects[band])
+        this->effects[band]->setBounds((band % 8) * 100, 350 + (band / 8) * 30,
+                                       100, 30);
+    const int i = band - 1;
+    if (i >= 0 && this->splits[i])
         this->splits[i]->setBounds((i % 8) * 100, 100 + (i / 8) * 100, 100,
                                    100);
+}
+
+void BandSplitterAudioProcessorEditor::showChainMenu(int band) {
+    BandChains& chains = audioProcessor.getChains();
+    const juce::StringArray names = chains.getPluginNames(band);
+
+    juce::PopupMenu menu;
+    menu.addItem("Add plugin...", names.size() < MAX_CHAIN_PLUGINS,
+                 false, [=]() { choosePlugin(band); });
+    menu.addSeparator();
+    for (int i = 0; i < names.size(); i++)
+        menu.addItem("Open " + names[i],
+                     [this, band, i]() {
+                         audioProcessor.getChains().showEditor(band, i);
+                     });
+    menu.addItem("Clear", !names.isEmpty(), false,
+                 [this, band]() { audioProcessor.getChains().clear(band); });
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(
+        &*this->effects[band]));
+}
+
+void BandSplitterAudioProcessorEditor::choosePlugin(int band) {
+    chooser = std::make_unique<juce::FileChooser>(
+        "Plugin for band " + juce::String(band + 1), juce::File(), "*.vst3");
+    // VST3 bundles are directories on macOS and Linux
+    const int flags = juce::FileBrowserComponent::openMode |
+                      juce::FileBrowserComponent::canSelectFiles |
+                      juce::FileBrowserComponent::canSelectDirectories;
+    chooser->launchAsync(flags, [this, band](const juce::FileChooser& fc) {
+        const juce::File file = fc.getResult();
+        if (file == juce::File()) return;
+        juce::String error;
+        if (!audioProcessor.getChains().loadPlugin(band, file, error))
+            juce::AlertWindow::showMessageBoxAsync(
+                juce::MessageBoxIconType::WarningIcon, "Band splitter", error);
+    });
+}
+
+void BandSplitterAudioProcessorEditor::chooseFileToSplit() {
+    chooser = std::make_unique<juce::FileChooser>(
+        "Audio file to split", juce::File(), "*.wav;*.aif;*.aiff;*.flac;*.ogg");
+    const int flags = juce::FileBrowserComponent::openMode |
+                      juce::FileBrowserComponent::canSelectFiles;
+    chooser->launchAsync(flags, [this](const juce::FileChooser& fc) {
+        const juce::File file = fc.getResult();
+        if (file != juce::File()) audioProcessor.splitFile(file);
+    });
+}
+
+void BandSplitterAudioProcessorEditor::showProgramMenu() {
+    const PresetBank& programs = audioProcessor.getPrograms();
+    const int selected = programs.getSelected();
+
+    juce::PopupMenu menu;
+    for (int k = 0; k < PROGRAMS; k++) {
+        if (k == FACTORY_PROGRAMS) menu.addSeparator();
+        menu.addItem(juce::String(programs.getProgram(k)->name), true,
+                     k == selected, [this, k]() {
+                         audioProcessor.setCurrentProgram(k);
+                         audioProcessor.updateHostDisplay(
+                             juce::AudioProcessorListener::ChangeDetails()
+                                 .withProgramChanged(true));
+                     });
     }
+    menu.addSeparator();
+    // Factory programs stay as they ship
+    menu.addItem("Store splits in " +
+                     juce::String(programs.getProgram(selected)->name),
+                 selected >= FACTORY_PROGRAMS, false,
+                 [this, selected]() { audioProcessor.storeProgram(selected); });
+    menu.addItem("Split audio file...", [this]() { chooseFileToSplit(); });
+    menu.showMenuAsync(
+        juce::PopupMenu::Options().withTargetComponent(&program));
 }
 
 BandListener::BandListener(juce::AudioParameterInt* param, juce::Label& label)
@@ -62,15 +215,17 @@ BandListener::BandListener(juce::AudioParameterInt* param, juce::Label& label)
 BandListener::~BandListener() { param->removeListener(this); }
 
 void BandListener::parameterValueChanged(int parameterIndex, float newValue) {
-    label.setText("Bands : " + std::to_string(*param),
-                  juce::NotificationType::sendNotificationAsync);
+    dirty = true;
 }
 void BandListener::parameterGestureChanged(int parameterIndex,
                                            bool gestureIsStarting) {
-    if (gestureIsStarting)
-        label.setText("Bands : " + std::to_string(*param) + "~",
-                      juce::NotificationType::sendNotificationAsync);
-    else
-        label.setText("Bands : " + std::to_string(*param),
-                      juce::NotificationType::sendNotificationAsync);
+    gesture = gestureIsStarting;
+    dirty = true;
+}
+
+void BandListener::refresh() {
+    // Labels only repaint when their text changes
+    if (!dirty.exchange(false)) return;
+    label.setText("Bands : " + std::to_string(*param) + (gesture ? "~" : ""),
+                  juce::NotificationType::dontSendNotification);
 }
\ No newline at end of file
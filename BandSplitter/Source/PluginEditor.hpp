@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 
 #include "JuceHeader.h"
 
@@ -9,6 +10,9 @@
 
 class BandSplitterAudioProcessor;
 
+// Parameter changes are batched and shown at most this many times a second
+constexpr int EDITOR_REFRESH_HZ = 30;
+
 class BandListener : public juce::AudioProcessorParameter::Listener {
    public:
     BandListener(juce::AudioParameterInt* param, juce::Label& label);
@@ -19,12 +23,17 @@ class BandListener : public juce::AudioProcessorParameter::Listener {
     void parameterGestureChanged(int parameterIndex,
                                  bool gestureIsStarting) override;
 
+    // Updates the label if the parameter changed since the last call
+    void refresh();
+
    private:
     juce::AudioParameterInt* param;
     juce::Label& label;
+    std::atomic<bool> dirty{false}, gesture{false};
 };
 
-class BandSplitterAudioProcessorEditor : public juce::AudioProcessorEditor {
+class BandSplitterAudioProcessorEditor : public juce::AudioProcessorEditor,
+                                         private juce::Timer {
    public:
     BandSplitterAudioProcessorEditor(BandSplitterAudioProcessor&);
     ~BandSplitterAudioProcessorEditor() override;
@@ -32,15 +41,36 @@ class BandSplitterAudioProcessorEditor : public juce::AudioProcessorEditor {
     void resized() override;
 
    private:
+    // Applies the parameter changes of the last frame
+    void timerCallback() override;
+
+    // Widgets of a band (its gain and the split under it) are only created
+    // once it is shown
+    void setBandVisible(int band, bool visible);
+    void layoutBand(int band);
+    // Menu of the plugins hosted on a band
+    void showChainMenu(int band);
+    void choosePlugin(int band);
+    // Menu of the programs, with storing the splits into a user one and
+    // splitting a file with them
+    void showProgramMenu();
+    void chooseFileToSplit();
+
     BandSplitterAudioProcessor& audioProcessor;
 
     juce::TextButton addBand;
     juce::TextButton removeBand;
     juce::Label bands;
+    juce::Label kernel;
+    juce::Label load;
+    juce::TextButton program;
 
     BandListener listener;
 
     std::array<std::optional<KnobComponent>, MAX_BANDS - 1> splits = {};
+    std::array<std::optional<KnobComponent>, MAX_BANDS> gains = {};
+    std::array<std::optional<juce::TextButton>, MAX_BANDS> effects = {};
+    std::unique_ptr<juce::FileChooser> chooser;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(
         BandSplitterAudioProcessorEditor)
@@ -1,5 +1,17 @@
 #include "PluginProcessor.hpp"
 
+// Split types before the allpass one, older states saved the type
+// normalized over them
+static constexpr int LEGACY_SPLIT_TYPES = 6;
+
+// Hosts round-trip between the 44.1kHz and 48kHz families, the matching
+// rate of the other family, 0 for any other rate
+static double getPartnerRate(double rate) {
+    if (std::fmod(rate, 44100) == 0) return rate / 44100 * 48000;
+    if (std::fmod(rate, 48000) == 0) return rate / 48000 * 44100;
+    return 0;
+}
+
 juce::AudioProcessor::BusesProperties
 BandSplitterAudioProcessor::createProperties() {
     juce::AudioProcessor::BusesProperties result;
@@ -17,24 +29,115 @@ BandSplitterAudioProcessor::BandSplitterAudioProcessor()
           new juce::AudioParameterInt({"bands", 1}, "Bands", 2, MAX_BANDS, 3)),
       bandParams({nullptr}),
       type(new juce::AudioParameterChoice({"type", 1}, "Filter type",
-                                          juce::StringArray{"Linkwitz-Riley 4"},
-                                          0)) {
+                                          createTypeNames(), LR4)),
+      align(new juce::AudioParameterBool({"align", 1}, "Time-align bands",
+                                         false)),
+      modSource(new juce::AudioParameterChoice(
+          {"mod source", 1}, "Modulation source",
+          juce::StringArray{"Off", "LFO", "Envelope"}, MOD_OFF)),
+      modRate(new juce::AudioParameterFloat(
+          {"mod rate", 1}, "Modulation rate",
+          juce::NormalisableRange<float>(.01f, 20, 0, .3f), 1)),
+      modDepth(new juce::AudioParameterFloat(
+          {"mod depth", 1}, "Modulation depth", 0, 4, 1)),
+      firBudget(new juce::AudioParameterInt({"fir budget", 1},
+                                            "Linear phase budget", 0,
+                                            MAX_FIR_BUDGET, 0)),
+      recombine(new juce::AudioParameterBool({"recombine", 1},
+                                             "Recombine bands", false)),
+      stereoMode(new juce::AudioParameterChoice(
+          {"stereo mode", 1}, "Stereo bands",
+          juce::StringArray{"Left/Right", "Mid/Side"}, STEREO_LR)),
+      monoBands(new juce::AudioParameterInt({"mono bands", 1}, "Mono bands",
+                                            0, MAX_BANDS, 0)),
+      cpuBudget(new juce::AudioParameterInt({"cpu budget", 1}, "CPU budget",
+                                            0, 100, 0)),
+      tapParam(new juce::AudioParameterBool({"tap", 1}, "Shared memory tap",
+                                            false)),
+      morphTime(new juce::AudioParameterFloat(
+          {"program morph", 1}, "Program morph",
+          juce::NormalisableRange<float>(0, MAX_MORPH_SECONDS, 0, .5f), 0)),
+      tapName(BandTap::createName()) {
     this->addParameter(this->bands);
     this->addParameter(this->type);
     for (int i = 0; i < MAX_BANDS - 1; i++) {
         this->bandParams[i] = new juce::AudioParameterFloat(
             {"split freq " + std::to_string(i + 1), 1},
             "Split frequency " + std::to_string(i + 1), 20, 20000,
-            100 + std::round(std::pow((float)i / MAX_BANDS, 2) * 200) * 100);
+            DEFAULT_SPLIT_FREQUENCIES[i]);
         this->addParameter(this->bandParams[i]);
     }
-    this->filters[0].setParameters(LOWPASS,
-                                   {.f = 20, .Q = .70710678118f, .gain = 0});
-    this->filters[MAX_BANDS - 1].setParameters(
-        HIGHPASS, {.f = 20, .Q = .70710678118f, .gain = 0});
+    for (int i = 0; i < MAX_BANDS; i++) {
+        this->gainParams[i] = new juce::AudioParameterFloat(
+            {"band gain " + std::to_string(i + 1), 1},
+            "Band gain " + std::to_string(i + 1), -60, 12, 0);
+        this->muteParams[i] = new juce::AudioParameterBool(
+            {"band mute " + std::to_string(i + 1), 1},
+            "Band mute " + std::to_string(i + 1), false);
+        this->soloParams[i] = new juce::AudioParameterBool(
+            {"band solo " + std::to_string(i + 1), 1},
+            "Band solo " + std::to_string(i + 1), false);
+        this->addParameter(this->gainParams[i]);
+        this->addParameter(this->muteParams[i]);
+        this->addParameter(this->soloParams[i]);
+    }
+
+    // Later parameters are appended to keep the host indices stable
+    this->addParameter(this->align);
+    this->addParameter(this->modSource);
+    this->addParameter(this->modRate);
+    this->addParameter(this->modDepth);
+    for (int i = 0; i < MAX_BANDS - 1; i++) {
+        this->modParams[i] = new juce::AudioParameterBool(
+            {"split mod " + std::to_string(i + 1), 1},
+            "Modulate split " + std::to_string(i + 1), false);
+        this->addParameter(this->modParams[i]);
+    }
+    this->addParameter(this->firBudget);
+    this->addParameter(this->recombine);
+    this->addParameter(this->stereoMode);
+    this->addParameter(this->monoBands);
+    this->addParameter(this->cpuBudget);
+    this->addParameter(this->tapParam);
+    for (int i = 0; i < MAX_BANDS - 1; i++) {
+        this->svfParams[i] = new juce::AudioParameterBool(
+            {"split svf " + std::to_string(i + 1), 1},
+            "State variable split " + std::to_string(i + 1), false);
+        this->addParameter(this->svfParams[i]);
+    }
+    this->addParameter(this->morphTime);
+    this->updateBandChannels();
+
+    juce::Logger::writeToLog(juce::String("BandSplitter DSP kernel: ") +
+                             getKernelName());
+}
+
+juce::StringArray BandSplitterAudioProcessor::createTypeNames() {
+    juce::StringArray result;
+    for (int i = 0; i < SPLIT_TYPES; i++)
+        result.add(getCrossoverDesign((SplitType)i).name);
+    return result;
+}
+
+BandSplitterAudioProcessor::~BandSplitterAudioProcessor() {
+    cancelPendingUpdate();
 }
 
-BandSplitterAudioProcessor::~BandSplitterAudioProcessor() {}
+void BandSplitterAudioProcessor::handleAsyncUpdate() {
+    const int latency = wantedLatency;
+    if (latency != getLatencySamples()) setLatencySamples(latency);
+
+    if (!tapWanted) {
+        tap.close();
+        return;
+    }
+    if (tap.isOpen()) return;
+    if (tap.open(tapName, getSampleRate()))
+        juce::Logger::writeToLog("BandSplitter band tap: " + tapName);
+    else
+        juce::Logger::writeToLog("BandSplitter can't open the band tap " +
+                                 tapName);
+}
 
 const juce::String BandSplitterAudioProcessor::getName() const {
     return JucePlugin_Name;
@@ -64,29 +167,122 @@ bool BandSplitterAudioProcessor::isMidiEffect() const {
 #endif
 }
 
-double BandSplitterAudioProcessor::getTailLengthSeconds() const { return 0.0; }
+double BandSplitterAudioProcessor::getTailLengthSeconds() const {
+    float f = *this->bandParams[0];
+    for (int i = 1; i < *bands - 1; i++) f = std::min(f, (float)*bandParams[i]);
+
+    const SplitterEngine& engine = *current.load();
+    const double rate = engine.getSampleRate();
+    return SplitterEngine::getTailLengthSeconds((SplitType)(int)*type, f) +
+           (engine.getLatencySamples() + chains.getLatencySamples()) / rate;
+}
 
-int BandSplitterAudioProcessor::getNumPrograms() { return 1; }
+int BandSplitterAudioProcessor::getNumPrograms() { return PROGRAMS; }
 
-int BandSplitterAudioProcessor::getCurrentProgram() { return 0; }
+int BandSplitterAudioProcessor::getCurrentProgram() {
+    return programs.getSelected();
+}
 
-void BandSplitterAudioProcessor::setCurrentProgram(int index) { (void)index; }
+void BandSplitterAudioProcessor::setCurrentProgram(int index) {
+    reclaimPrograms();
+    const Program* program = programs.select(index);
+    if (program == nullptr) return;
+    // The audio thread switches at once, whatever it reads of the
+    // parameters while they are being set
+    settledProgram.store(nullptr, std::memory_order_release);
+    pendingProgram.store(program, std::memory_order_release);
+    SET_PARAM_NORMALIZED(bands, program->bands);
+    SET_PARAM_NORMALIZED(type, (int)program->type);
+    for (int i = 0; i < MAX_BANDS - 1; i++) {
+        SET_PARAM_NORMALIZED(bandParams[i], program->frequencies[i]);
+        SET_PARAM_NORMALIZED(svfParams[i], program->svf[i]);
+    }
+    settledProgram.store(program, std::memory_order_release);
+}
 
 const juce::String BandSplitterAudioProcessor::getProgramName(int index) {
-    (void)index;
-    return {};
+    const Program* program = programs.getProgram(index);
+    return program != nullptr ? juce::String(program->name) : juce::String();
 }
 
 void BandSplitterAudioProcessor::changeProgramName(
     int index, const juce::String& newName) {
-    (void)index;
-    (void)newName;
+    // Factory programs are not saved with the state, renaming them would not
+    // last
+    if (index < FACTORY_PROGRAMS) return;
+    programs.rename(index, newName.toStdString());
+    reclaimPrograms();
+}
+
+void BandSplitterAudioProcessor::storeProgram(int index) {
+    if (index < FACTORY_PROGRAMS) return;
+    const Program* stored = programs.getProgram(index);
+    if (stored == nullptr) return;
+    Program program = *stored;
+    program.bands = *bands;
+    program.type = (SplitType)(int)*type;
+    for (int i = 0; i < MAX_BANDS - 1; i++) {
+        program.frequencies[i] = *bandParams[i];
+        program.svf[i] = *svfParams[i];
+    }
+    programs.store(index, program);
+    reclaimPrograms();
+    if (getSampleRate() > 0)
+        current.load()->prepareDesigns(getSampleRate(), program.type,
+                                       program.frequencies);
+}
+
+float BandSplitterAudioProcessor::getParamFrequency(int split,
+                                                    float f) const {
+    const juce::AudioParameterFloat* param = bandParams[split];
+    return param->convertFrom0to1(param->convertTo0to1(f));
 }
 
 void BandSplitterAudioProcessor::prepareToPlay(double sampleRate,
                                                int samplesPerBlock) {
-    (void)sampleRate;
-    (void)samplesPerBlock;
+    this->updateBandChannels();
+    this->engineLevel = governor.getLevel();
+    this->updateEngine();
+    // A morph doesn't outlive the rate it started at
+    morphLength = morphPosition = 0;
+    fading->prepare(sampleRate);
+    current.load()->prepare(sampleRate);
+    this->prepareDesigns(sampleRate);
+    this->chains.prepare(
+        sampleRate, samplesPerBlock,
+        std::max(1, std::min(getTotalNumInputChannels(), MAX_CHANNELS)));
+    this->recombineBuffer.setSize(MAX_BANDS * MAX_CHANNELS, samplesPerBlock);
+    this->morphBuffer.setSize(MAX_BANDS * MAX_CHANNELS + 2, samplesPerBlock);
+    this->tap.setSampleRate(sampleRate);
+    this->wantedLatency =
+        current.load()->getLatencySamples() + chains.getLatencySamples();
+    this->setLatencySamples(wantedLatency);
+}
+
+void BandSplitterAudioProcessor::prepareDesigns(double sampleRate) {
+    auto last = std::remove(preparedRates.begin(), preparedRates.end(),
+                            sampleRate);
+    if (last == preparedRates.end()) last--;
+    std::move_backward(preparedRates.begin(), last, last + 1);
+    preparedRates[0] = sampleRate;
+
+    SplitterEngine& engine = *current.load();
+    const SplitType t = (SplitType)(int)*type;
+    for (const double rate : preparedRates)
+        if (rate > 0) engine.prepareDesigns(rate, t);
+    const double partner = getPartnerRate(sampleRate);
+    if (partner > 0) engine.prepareDesigns(partner, t);
+    // The governor switches to a cheaper type from the audio thread
+    engine.prepareDesigns(
+        sampleRate, LoadGovernor::degradeType(t, GOVERNOR_CHEAPER_SPLITS));
+    // Programs switch without designing anything on the audio thread
+    for (int k = 0; k < PROGRAMS; k++) {
+        const Program* program = programs.getProgram(k);
+        float frequencies[MAX_BANDS - 1];
+        for (int i = 0; i < MAX_BANDS - 1; i++)
+            frequencies[i] = getParamFrequency(i, program->frequencies[i]);
+        engine.prepareDesigns(sampleRate, program->type, frequencies);
+    }
 }
 
 void BandSplitterAudioProcessor::releaseResources() {}
@@ -98,11 +294,23 @@ bool BandSplitterAudioProcessor::isBusesLayoutSupported(
     juce::ignoreUnused(layouts);
     return true;
 #else
+    // Packed layout, the main output holds every band and the band buses
+    // are off
+    const juce::AudioChannelSet mainOutput = layouts.getMainOutputChannelSet();
+    if (mainOutput.size() > MAX_CHANNELS) {
+        const auto& outputs = layouts.getBuses(false);
+        for (int i = 1; i < outputs.size(); i++)
+            if (!outputs[i].isDisabled()) return false;
+        return mainOutput.size() <= MAX_BANDS * MAX_CHANNELS &&
+               layouts.getMainInputChannelSet().size() <= MAX_CHANNELS;
+    }
+
     if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono() &&
         layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
         return false;
 
     for (const auto& bus : layouts.getBuses(false)) {
+        if (bus.isDisabled()) continue;
         if (bus != juce::AudioChannelSet::mono() &&
             bus != juce::AudioChannelSet::stereo())
             return false;
@@ -118,156 +326,349 @@ bool BandSplitterAudioProcessor::isBusesLayoutSupported(
 }
 #endif
 
-#define BUF(i) buffer.getWritePointer(i)
+void BandSplitterAudioProcessor::processorLayoutsChanged() {
+    this->updateBandChannels();
+}
 
-#define GET_STATE_BLOCK(ptr, BLK_SIZE, blk, filter, loops) \
-    ((ptr) + ((blk) * (BLK_SIZE) + (filter) * (2 * (loops) + 2)))
+void BandSplitterAudioProcessor::updateBandChannels() {
+    const Bus* main = getBus(false, 0);
+    packedChannels = main != nullptr && main->isEnabled() &&
+                             main->getNumberOfChannels() > MAX_CHANNELS
+                         ? main->getNumberOfChannels()
+                         : 0;
+    // Packed bands follow the band count, they are placed every block
+    if (packedChannels > 0) return;
 
-void BandSplitterAudioProcessor::processMono(juce::AudioBuffer<float>& buffer) {
-    const int inputs = getTotalNumInputChannels();
-    const int outputs = getTotalNumOutputChannels();
-
-    const int samples = buffer.getNumSamples();
-    const double rate = getSampleRate();
-
-    int n = *bands;
-    if (n > outputs) n = outputs;
-    if (lastBands != n) {
-        lastBands = n;
-        buffer.clear();
-        for (int i = 0; i < n - 1; i++) {
-            float f = *this->bandParams[i];
-            filters[i].setParameters(LOWPASS,
-                                     {.f = f, .Q = .70710678118f, .gain = 0});
-            filters[i + MAX_BANDS - 1].setParameters(
-                HIGHPASS, {.f = f, .Q = .70710678118f, .gain = 0});
+    for (int i = 0; i < MAX_BANDS; i++) {
+        const Bus* bus = getBus(false, i);
+        if (bus == nullptr || !bus->isEnabled() ||
+            bus->getNumberOfChannels() == 0) {
+            bandChannels[i] = -1;
+            bandChannelCounts[i] = 0;
+            continue;
         }
-        return;
+        bandChannels[i] = getChannelIndexInProcessBlockBuffer(false, i, 0);
+        bandChannelCounts[i] = bus->getNumberOfChannels();
     }
+}
 
-    // Copy buffer data
-    for (int i = 0; i < n - 1; i++) {
-        std::memcpy(BUF(i + 1), BUF(i), samples * sizeof(float));
+int BandSplitterAudioProcessor::packBands(int n, int channels) {
+    if (n * channels > packedChannels) channels = 1;
+    for (int j = 0; j < MAX_BANDS; j++) {
+        const bool fits = j < n && (j + 1) * channels <= packedChannels;
+        bandChannels[j] = fits ? j * channels : -1;
+        bandChannelCounts[j] = fits ? channels : 0;
     }
+    return channels;
+}
 
-    const int t = *type;
-
-    for (int i = 0; i < n - 1; i++) {
-        float *data = BUF(i), *next = BUF(i + 1);
-
-        BiquadFilter &lp = filters[i], &hp = filters[i + MAX_BANDS - 1];
+void BandSplitterAudioProcessor::updateEngine() {
+    // The program's splits run until the parameters caught up with them
+    const Program* program = heldProgram.load(std::memory_order_relaxed);
+    if (program != nullptr &&
+        settledProgram.load(std::memory_order_acquire) == program) {
+        program = nullptr;
+        heldProgram.store(nullptr, std::memory_order_release);
+    }
+    // The governor's level overrides what costs the most
+    applyParameters(*current.load(std::memory_order_relaxed), program,
+                    engineLevel);
+}
 
-        // Update filter
-        const float f = *this->bandParams[i];
-        if (lp.getParameters().f != f) {
-            lp.setParameters(LOWPASS, {.f = f, .Q = .70710678118f, .gain = 0});
-            hp.setParameters(HIGHPASS, {.f = f, .Q = .70710678118f, .gain = 0});
-        }
+void BandSplitterAudioProcessor::followGovernor(int samples) {
+    governor.setBudget(isNonRealtime() ? 0 : *cpuBudget / 100.f);
+    const int level = governor.getLevel();
+    if (level == engineLevel) return;
+
+    // A new type or splits switching between FIR and IIR start over from
+    // silence, and the bands jump when the alignment stops
+    const Program* program = heldProgram.load(std::memory_order_relaxed);
+    const SplitType t =
+        program != nullptr ? program->type : (SplitType)(int)*type;
+    const bool restarts =
+        LoadGovernor::degradeType(t, level) !=
+            LoadGovernor::degradeType(t, engineLevel) ||
+        (*firBudget > 0 && (level < GOVERNOR_NO_LINEAR_PHASE) !=
+                               (engineLevel < GOVERNOR_NO_LINEAR_PHASE)) ||
+        (*align && (level < GOVERNOR_STATIC_SPLITS) !=
+                       (engineLevel < GOVERNOR_STATIC_SPLITS));
+    if (restarts) {
+        // The step waits for a morph in progress to end
+        if (morphPosition < morphLength) return;
+        startMorph((int)(GAIN_RAMP_SECONDS * getSampleRate()), samples);
+    }
+    engineLevel = level;
+}
 
-        // Run filter
-        for (int j = 0; j <= i; j++) {
-            lp.processBlockMul(BUF(j), samples,
-                               GET_STATE_BLOCK(lp_states, STATE_BLK, j, i, 2),
-                               2);
-        }
-        for (int j = n - 1; j > i; j--) {
-            hp.processBlockMul(
-                BUF(j - 1), samples,
-                GET_STATE_BLOCK(hp_states, STATE_BLK, j - 1, i, 2), 2);
-        }
+void BandSplitterAudioProcessor::applyParameters(SplitterEngine& engine,
+                                                 const Program* program,
+                                                 int level) const {
+    const bool moving = level < GOVERNOR_STATIC_SPLITS;
+    engine.setBands(program != nullptr ? program->bands : *bands);
+    engine.setSplitType(LoadGovernor::degradeType(
+        program != nullptr ? program->type : (SplitType)(int)*type, level));
+    for (int i = 0; i < MAX_BANDS - 1; i++) {
+        engine.setSplitFrequency(
+            i, program != nullptr
+                   ? getParamFrequency(i, program->frequencies[i])
+                   : *this->bandParams[i]);
+        engine.setSplitModulation(i, *this->modParams[i]);
+        const bool svf =
+            program != nullptr ? program->svf[i] : *this->svfParams[i];
+        engine.setSplitTopology(i, svf ? TOPOLOGY_SVF : TOPOLOGY_DIRECT);
     }
-    if (!std::isfinite(BUF(0)[0])) {
-        std::memset(lp_states, 0, sizeof(lp_states));
-        std::memset(hp_states, 0, sizeof(hp_states));
+    for (int j = 0; j < MAX_BANDS; j++) {
+        engine.setBandGain(
+            j, juce::Decibels::decibelsToGain((float)*this->gainParams[j]));
+        engine.setBandMute(j, *this->muteParams[j]);
+        engine.setBandSolo(j, *this->soloParams[j]);
     }
+    engine.setAlignment(*align && moving);
+    engine.setModulation(moving ? (ModSource)(int)*modSource : MOD_OFF,
+                         *modRate, *modDepth);
+    engine.setFirBudget(level < GOVERNOR_NO_LINEAR_PHASE ? *firBudget : 0);
+    // Linear phase splits the governor turned back to IIR leave their delay
+    // behind, the latency only moves with the budget and the frequencies
+    engine.setPaddingBudget(level < GOVERNOR_NO_LINEAR_PHASE ? 0 : *firBudget,
+                            *modSource != MOD_OFF);
+    engine.setStereoMode((StereoMode)(int)*stereoMode);
+    engine.setMonoBands(*monoBands);
 }
 
-void BandSplitterAudioProcessor::processStereo(
-    juce::AudioBuffer<float>& buffer) {
-    const int inputs = getTotalNumInputChannels();
-    const int outputs = getTotalNumOutputChannels();
+void BandSplitterAudioProcessor::splitFile(const juce::File& input) {
+    // The file gets an engine of its own with the splits as they are now,
+    // at full quality whatever the governor is at
+    auto engine = std::make_shared<SplitterEngine>();
+    applyParameters(*engine, nullptr, GOVERNOR_FULL);
+
+    juce::Array<juce::File> outputs;
+    for (int j = 0; j < engine->getBands(); j++)
+        outputs.add(input.getSiblingFile(input.getFileNameWithoutExtension() +
+                                         " band " + juce::String(j + 1) +
+                                         input.getFileExtension()));
+
+    fileJobs.addJob([engine, input, outputs]() {
+        FileSplitter splitter(*engine);
+        const juce::Result result = splitter.split(input, outputs);
+        juce::MessageManager::callAsync([result, input]() {
+            juce::AlertWindow::showMessageBoxAsync(
+                result.wasOk() ? juce::MessageBoxIconType::InfoIcon
+                               : juce::MessageBoxIconType::WarningIcon,
+                "Band splitter",
+                result.wasOk()
+                    ? "Split " + input.getFileName() + " into its bands"
+                    : result.getErrorMessage());
+        });
+    });
+}
 
-    const int samples = buffer.getNumSamples();
-    const double rate = getSampleRate();
+void BandSplitterAudioProcessor::startProgram(const Program* program,
+                                              int samples) {
+    heldProgram.store(program, std::memory_order_release);
+    // A morph in progress keeps fading out the same splits, the program
+    // replaces the ones it fades in
+    if (morphPosition < morphLength) return;
+
+    double seconds = *morphTime;
+    // Rewired bands would start over from silence, they fade instead
+    if (seconds == 0 &&
+        program->bands != current.load(std::memory_order_relaxed)->getBands())
+        seconds = GAIN_RAMP_SECONDS;
+    startMorph((int)(seconds * getSampleRate()), samples);
+}
 
-    const size_t bufSize = samples * sizeof(float);
+bool BandSplitterAudioProcessor::startMorph(int length, int samples) {
+    if (length == 0 || samples > morphBuffer.getNumSamples()) return false;
+
+    // The old splits keep running as they were, the new ones start from
+    // silence in the other engine
+    SplitterEngine* engine = current.load(std::memory_order_relaxed);
+    fading->reset();
+    current.store(fading, std::memory_order_relaxed);
+    fading = engine;
+    morphLength = length;
+    morphPosition = 0;
+    return true;
+}
 
-    int n = *bands;
-    if (n * 2 > outputs) n = outputs / 2;
-    if (lastBands != n) {
-        lastBands = n;
-        buffer.clear();
-        for (int i = 0; i < n - 1; i++) {
-            float f = *this->bandParams[i];
-            filters[i].setParameters(LOWPASS,
-                                     {.f = f, .Q = .70710678118f, .gain = 0});
-            filters[i + MAX_BANDS - 1].setParameters(
-                HIGHPASS, {.f = f, .Q = .70710678118f, .gain = 0});
-        }
+void BandSplitterAudioProcessor::morphBands(float* const* outputs, int n,
+                                            int channels,
+                                            const float* const* input,
+                                            int samples) {
+    SplitterEngine& engine = *current.load(std::memory_order_relaxed);
+    if (samples > morphBuffer.getNumSamples()) {
+        morphLength = morphPosition = 0;
+        engine.process(input, channels, outputs, samples);
         return;
     }
 
-    // Copy buffer data
-    for (int i = 0; i < n - 1; i++) {
-        std::memcpy(BUF(i * 2 + 2), BUF(i * 2), bufSize);
-        std::memcpy(BUF(i * 2 + 3), BUF(i * 2 + 1), bufSize);
+    // The old splits read the input first, the new ones may write over it
+    float* old[MAX_BANDS * MAX_CHANNELS] = {};
+    for (int k = 0; k < n * channels; k++)
+        old[k] = morphBuffer.getWritePointer(k);
+    fading->process(input, channels, old, samples);
+    engine.process(input, channels, outputs, samples);
+
+    // Equal power, the bands of different splits are mostly uncorrelated
+    float* fadeOut = morphBuffer.getWritePointer(MAX_BANDS * MAX_CHANNELS);
+    float* fadeIn = morphBuffer.getWritePointer(MAX_BANDS * MAX_CHANNELS + 1);
+    for (int i = 0; i < samples; i++) {
+        const double phase =
+            std::min(1.0, (double)(morphPosition + i) / morphLength) * M_PI /
+            2;
+        fadeOut[i] = (float)std::cos(phase);
+        fadeIn[i] = (float)std::sin(phase);
     }
-
-    for (int i = 0; i < n - 1; i++) {
-        float *l = BUF(i * 2), *r = BUF(i * 2 + 1);
-        float *l2 = BUF(i * 2 + 2), *r2 = BUF(i * 2 + 3);
-
-        BiquadFilter &lp = filters[i], &hp = filters[i + MAX_BANDS - 1];
-
-        // Update filter
-        const float f = *this->bandParams[i];
-        if (lp.getParameters().f != f) {
-            lp.setParameters(LOWPASS, {.f = f, .Q = .70710678118f, .gain = 0});
-            hp.setParameters(HIGHPASS, {.f = f, .Q = .70710678118f, .gain = 0});
-        }
-
-        // Run filters
-        for (int j = 0; j <= i; j++) {
-            lp.processBlockMul(
-                BUF(j * 2), samples,
-                GET_STATE_BLOCK(lp_states, STATE_BLK, j * 2, i, 2), 2);
-            lp.processBlockMul(
-                BUF(j * 2 + 1), samples,
-                GET_STATE_BLOCK(lp_states, STATE_BLK, j * 2 + 1, i, 2), 2);
-        }
-        for (int j = n - 1; j > i; j--) {
-            hp.processBlockMul(
-                BUF(j * 2), samples,
-                GET_STATE_BLOCK(hp_states, STATE_BLK, (j - 1) * 2, i, 2), 2);
-            hp.processBlockMul(
-                BUF(j * 2 + 1), samples,
-                GET_STATE_BLOCK(hp_states, STATE_BLK, (j - 1) * 2 + 1, i, 2),
-                2);
+    const int oldBands = fading->getBands(), newBands = engine.getBands();
+    for (int j = 0; j < n; j++) {
+        for (int c = 0; c < channels; c++) {
+            float* out = outputs[j * channels + c];
+            const float* from = old[j * channels + c];
+            if (out == nullptr) continue;
+            if (j >= oldBands) {
+                for (int i = 0; i < samples; i++) out[i] *= fadeIn[i];
+            } else if (j >= newBands) {
+                for (int i = 0; i < samples; i++)
+                    out[i] = from[i] * fadeOut[i];
+            } else {
+                for (int i = 0; i < samples; i++)
+                    out[i] = from[i] * fadeOut[i] + out[i] * fadeIn[i];
+            }
         }
     }
 
-    if (!std::isfinite(BUF(0)[0])) {
-        std::memset(lp_states, 0, sizeof(lp_states));
-        std::memset(hp_states, 0, sizeof(hp_states));
-    }
+    morphPosition += samples;
+    if (morphPosition >= morphLength) morphLength = morphPosition = 0;
 }
 
+#define BUF(i) buffer.getWritePointer(i)
+#define BAND(j, c) BUF(bandChannels[j] + (c))
+
 void BandSplitterAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
                                               juce::MidiBuffer& midiMessages) {
     (void)midiMessages;
 
+    splitSeconds = 0;
+    processBands(buffer);
+    blockEpoch.fetch_add(1, std::memory_order_release);
+    // Offline renders have no deadline to meet
+    if (isNonRealtime()) return;
+    governor.update(splitSeconds, buffer.getNumSamples(), getSampleRate());
+}
+
+void BandSplitterAudioProcessor::processBands(
+    juce::AudioBuffer<float>& buffer) {
     juce::ScopedNoDenormals noDenormals;
     const int inputs = getTotalNumInputChannels();
     const int outputs = getTotalNumOutputChannels();
 
     if (inputs == 0) return;
     if (outputs == 0) return;
-    if (outputs <= inputs) return;
 
-    if (inputs == 1) {
-        processMono(buffer);
-    } else {
-        processStereo(buffer);
+    const int samples = buffer.getNumSamples();
+    int channels = std::min(inputs, MAX_CHANNELS);
+    const Program* program =
+        pendingProgram.exchange(nullptr, std::memory_order_acquire);
+    if (program != nullptr) startProgram(program, samples);
+    followGovernor(samples);
+    updateEngine();
+    SplitterEngine& engine = *current.load(std::memory_order_relaxed);
+    // Bands that only the old splits have fade out
+    const bool morphing = morphPosition < morphLength;
+    const int n = morphing ? std::max(engine.getBands(), fading->getBands())
+                           : engine.getBands();
+
+    if (packedChannels > 0) {
+        const int packed = packBands(n, channels);
+        // Mono bands split the downmix, written over the first input channel
+        if (packed < channels) {
+            buffer.addFrom(0, 0, buffer, 1, 0, samples);
+            buffer.applyGain(0, 0, samples, .5f);
+        }
+        channels = packed;
+    }
+
+    // Recombined bands don't need their buses, they are summed into the
+    // main output afterwards
+    const bool recombining =
+        *recombine && samples <= recombineBuffer.getNumSamples();
+
+    // Bands on buses with fewer channels than the input are left out
+    const float* input[MAX_CHANNELS] = {};
+    float* bandOutputs[MAX_BANDS * MAX_CHANNELS] = {};
+    for (int c = 0; c < channels; c++) input[c] = buffer.getReadPointer(c);
+    for (int j = 0; j < n; j++) {
+        if (recombining) {
+            for (int c = 0; c < channels; c++)
+                bandOutputs[j * channels + c] =
+                    recombineBuffer.getWritePointer(j * MAX_CHANNELS + c);
+            continue;
+        }
+        if (bandChannels[j] < 0 || bandChannelCounts[j] < channels) continue;
+        for (int c = 0; c < channels; c++)
+            bandOutputs[j * channels + c] = BAND(j, c);
+    }
+
+    // Only the split is timed, degrading it can't win back what the hosted
+    // plugins take
+    const juce::int64 start = juce::Time::getHighResolutionTicks();
+    if (morphing)
+        morphBands(bandOutputs, n, channels, input, samples);
+    else
+        engine.process(input, channels, bandOutputs, samples);
+    splitSeconds = juce::Time::highResolutionTicksToSeconds(
+        juce::Time::getHighResolutionTicks() - start);
+    chains.process(bandOutputs, n, channels, samples);
+
+    // Opening the tap allocates, the message thread does it
+    const bool wanted = *tapParam;
+    if (tapWanted.exchange(wanted) != wanted) triggerAsyncUpdate();
+    tap.write(bandOutputs, n, channels, samples);
+
+    // The FIR budget and hosted plugins change the latency at any time,
+    // hosts are told about it from the message thread
+    const int latency = engine.getLatencySamples() + chains.getLatencySamples();
+    if (wantedLatency.exchange(latency) != latency) triggerAsyncUpdate();
+
+    if (recombining) {
+        const int mainChannels = getMainBusNumOutputChannels();
+        for (int i = 0; i < buffer.getNumChannels(); i++) {
+            if (i >= mainChannels) {
+                buffer.clear(i, 0, samples);
+                continue;
+            }
+            const int c = std::min(i, channels - 1);
+            buffer.copyFrom(i, 0, bandOutputs[c], samples);
+            for (int j = 1; j < n; j++)
+                buffer.addFrom(i, 0, bandOutputs[j * channels + c], samples);
+        }
+        // Mid/side bands were processed as such, the sum goes back to
+        // left and right
+        if (channels == 2 && mainChannels >= 2 && *stereoMode == STEREO_MS) {
+            float* left = BUF(0);
+            float* right = BUF(1);
+            for (int i = 0; i < samples; i++) {
+                const float m = left[i], s = right[i];
+                left[i] = m + s;
+                right[i] = m - s;
+            }
+        }
+        return;
+    }
+
+    // Stereo buses get mono bands on both sides, every channel that isn't
+    // part of a band is cleared
+    std::array<bool, MAX_BANDS * MAX_CHANNELS> written = {};
+    for (int j = 0; j < n; j++) {
+        if (bandOutputs[j * channels] == nullptr) continue;
+        for (int c = channels; c < bandChannelCounts[j]; c++)
+            std::memcpy(BAND(j, c), BAND(j, 0), samples * sizeof(float));
+        for (int c = 0; c < bandChannelCounts[j]; c++)
+            written[bandChannels[j] + c] = true;
+    }
+    for (int i = 0; i < buffer.getNumChannels(); i++) {
+        if (i >= (int)written.size() || !written[i])
+            buffer.clear(i, 0, samples);
     }
 }
 
@@ -286,20 +687,137 @@ void BandSplitterAudioProcessor::getStateInformation(
     for (int i = 0; i < MAX_BANDS - 1; i++) {
         stream.writeFloat(GET_PARAM_NORMALIZED(bandParams[i]));
     }
+    for (int i = 0; i < MAX_BANDS; i++) {
+        stream.writeFloat(GET_PARAM_NORMALIZED(gainParams[i]));
+        stream.writeFloat(GET_PARAM_NORMALIZED(muteParams[i]));
+        stream.writeFloat(GET_PARAM_NORMALIZED(soloParams[i]));
+    }
+    stream.writeFloat(GET_PARAM_NORMALIZED(align));
+    stream.writeFloat(GET_PARAM_NORMALIZED(modSource));
+    stream.writeFloat(GET_PARAM_NORMALIZED(modRate));
+    stream.writeFloat(GET_PARAM_NORMALIZED(modDepth));
+    for (int i = 0; i < MAX_BANDS - 1; i++) {
+        stream.writeFloat(GET_PARAM_NORMALIZED(modParams[i]));
+    }
+    stream.writeFloat(GET_PARAM_NORMALIZED(firBudget));
+    stream.writeInt(type->getIndex());
+    stream.writeFloat(GET_PARAM_NORMALIZED(recombine));
+    stream.writeString(chains.createXml()->toString());
+    stream.writeFloat(GET_PARAM_NORMALIZED(stereoMode));
+    stream.writeFloat(GET_PARAM_NORMALIZED(monoBands));
+    stream.writeFloat(GET_PARAM_NORMALIZED(cpuBudget));
+    stream.writeFloat(GET_PARAM_NORMALIZED(tapParam));
+    for (int i = 0; i < MAX_BANDS - 1; i++) {
+        stream.writeFloat(GET_PARAM_NORMALIZED(svfParams[i]));
+    }
+    stream.writeFloat(GET_PARAM_NORMALIZED(morphTime));
+    stream.writeInt(programs.getSelected());
+    // Only the user programs, the factory ones come with the plugin
+    stream.writeInt(USER_PROGRAMS);
+    for (int k = FACTORY_PROGRAMS; k < PROGRAMS; k++) {
+        const Program* program = programs.getProgram(k);
+        stream.writeString(juce::String(program->name));
+        stream.writeInt(program->bands);
+        stream.writeInt(program->type);
+        for (int i = 0; i < MAX_BANDS - 1; i++) {
+            stream.writeFloat(program->frequencies[i]);
+            stream.writeBool(program->svf[i]);
+        }
+    }
 }
 
 void BandSplitterAudioProcessor::setStateInformation(const void* data,
                                                      int sizeInBytes) {
     juce::MemoryInputStream stream(data, static_cast<size_t>(sizeInBytes),
                                    false);
-    int n = stream.readInt();
-    if (n > MAX_BANDS) n = MAX_BANDS;
+    // Band count of the build that saved the state, clamped so that a
+    // corrupt state can't index past the parameters
+    const int n = std::clamp(stream.readInt(), 0, MAX_BANDS);
 
     bands->setValueNotifyingHost(stream.readFloat());
-    type->setValueNotifyingHost(stream.readFloat());
-    for (int i = 0; i < n - 1; i++) {
+    // Overridden by the index at the end of newer states
+    SET_PARAM_NORMALIZED(
+        type, juce::roundToInt(stream.readFloat() * (LEGACY_SPLIT_TYPES - 1)));
+    for (int i = 0; i < n - 1; i++)
         this->bandParams[i]->setValueNotifyingHost(stream.readFloat());
+
+    // Band gains were added later, older states stop here
+    if (stream.isExhausted()) return;
+    for (int i = 0; i < n; i++) {
+        this->gainParams[i]->setValueNotifyingHost(stream.readFloat());
+        this->muteParams[i]->setValueNotifyingHost(stream.readFloat());
+        this->soloParams[i]->setValueNotifyingHost(stream.readFloat());
+    }
+
+    if (stream.isExhausted()) return;
+    align->setValueNotifyingHost(stream.readFloat());
+
+    if (stream.isExhausted()) return;
+    modSource->setValueNotifyingHost(stream.readFloat());
+    modRate->setValueNotifyingHost(stream.readFloat());
+    modDepth->setValueNotifyingHost(stream.readFloat());
+    for (int i = 0; i < n - 1; i++)
+        this->modParams[i]->setValueNotifyingHost(stream.readFloat());
+
+    if (stream.isExhausted()) return;
+    firBudget->setValueNotifyingHost(stream.readFloat());
+
+    if (stream.isExhausted()) return;
+    const int typeIndex = stream.readInt();
+    if (typeIndex >= 0 && typeIndex < SPLIT_TYPES)
+        SET_PARAM_NORMALIZED(type, typeIndex);
+
+    if (stream.isExhausted()) return;
+    recombine->setValueNotifyingHost(stream.readFloat());
+    // Hosted plugins are created with the message thread locked
+    const std::unique_ptr<juce::XmlElement> xml =
+        juce::parseXML(stream.readString());
+    if (xml != nullptr) {
+        const juce::MessageManagerLock lock;
+        chains.restoreXml(*xml);
     }
+
+    if (stream.isExhausted()) return;
+    stereoMode->setValueNotifyingHost(stream.readFloat());
+    monoBands->setValueNotifyingHost(stream.readFloat());
+
+    if (stream.isExhausted()) return;
+    cpuBudget->setValueNotifyingHost(stream.readFloat());
+
+    if (stream.isExhausted()) return;
+    tapParam->setValueNotifyingHost(stream.readFloat());
+
+    if (stream.isExhausted()) return;
+    for (int i = 0; i < n - 1; i++)
+        this->svfParams[i]->setValueNotifyingHost(stream.readFloat());
+
+    if (stream.isExhausted()) return;
+    morphTime->setValueNotifyingHost(stream.readFloat());
+    const int selected = stream.readInt();
+    const int count = stream.readInt();
+    for (int k = 0; k < count && !stream.isExhausted(); k++) {
+        Program program = {};
+        program.name = stream.readString().toStdString();
+        program.bands = std::clamp(stream.readInt(), 2, MAX_BANDS);
+        const int t = stream.readInt();
+        program.type = t >= 0 && t < SPLIT_TYPES ? (SplitType)t : LR4;
+        for (int i = 0; i < n - 1; i++) {
+            program.frequencies[i] = stream.readFloat();
+            program.svf[i] = stream.readBool();
+        }
+        programs.store(FACTORY_PROGRAMS + k, program);
+    }
+    // The parameters were restored with the rest, nothing to switch
+    programs.select(selected);
+    reclaimPrograms();
+}
+
+void BandSplitterAudioProcessor::reclaimPrograms() {
+    // The epoch first, a program the audio thread takes from pendingProgram
+    // after that is seen held once a block ended
+    const unsigned int epoch = blockEpoch.load(std::memory_order_acquire);
+    programs.reclaim(epoch, {pendingProgram.load(std::memory_order_acquire),
+                             heldProgram.load(std::memory_order_acquire)});
 }
 
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter() {
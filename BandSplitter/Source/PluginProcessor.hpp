@@ -1,21 +1,26 @@
 #pragma once
 
-constexpr int MAX_BANDS = 8;
-
-enum SplitType { LR4 };
+#include "SplitterEngine.hpp"
 
 #include "JuceHeader.h"
 
-#include "PluginEditor.hpp"
-#include "BiquadFilter.hpp"
+#include "BandChains.hpp"
+#include "BandTap.hpp"
+#include "FileSplitter.hpp"
+#include "LoadGovernor.hpp"
+#include "PresetBank.hpp"
 
-constexpr size_t STATE_BLK = (MAX_BANDS - 1) * 6;
+#include "PluginEditor.hpp"
 
 #define GET_PARAM_NORMALIZED(param) (param->convertTo0to1(*param))
 #define SET_PARAM_NORMALIZED(param, value) \
     param->setValueNotifyingHost(param->convertTo0to1(value))
 
-class BandSplitterAudioProcessor : public juce::AudioProcessor {
+// Sample rates of the host whose designs are kept ready
+constexpr int PREPARED_RATES = 4;
+
+class BandSplitterAudioProcessor : public juce::AudioProcessor,
+                                   private juce::AsyncUpdater {
    public:
     BandSplitterAudioProcessor();
     ~BandSplitterAudioProcessor() override;
@@ -26,6 +31,7 @@ class BandSplitterAudioProcessor : public juce::AudioProcessor {
 #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported(const BusesLayout& layouts) const override;
 #endif
+    void processorLayoutsChanged() override;
 
     void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
 
@@ -54,23 +60,178 @@ class BandSplitterAudioProcessor : public juce::AudioProcessor {
         return bandParams[split];
     }
     inline juce::AudioParameterChoice* getTypeParam() { return type; }
+    inline juce::AudioParameterFloat* getGainParam(int band) {
+        return gainParams[band];
+    }
+    inline juce::AudioParameterBool* getMuteParam(int band) {
+        return muteParams[band];
+    }
+    inline juce::AudioParameterBool* getSoloParam(int band) {
+        return soloParams[band];
+    }
+    inline juce::AudioParameterBool* getAlignParam() { return align; }
+    inline juce::AudioParameterChoice* getModSourceParam() {
+        return modSource;
+    }
+    inline juce::AudioParameterFloat* getModRateParam() { return modRate; }
+    inline juce::AudioParameterFloat* getModDepthParam() { return modDepth; }
+    inline juce::AudioParameterBool* getModParam(int split) {
+        return modParams[split];
+    }
+    inline juce::AudioParameterInt* getFirBudgetParam() { return firBudget; }
+    inline juce::AudioParameterBool* getRecombineParam() { return recombine; }
+    inline juce::AudioParameterChoice* getStereoModeParam() {
+        return stereoMode;
+    }
+    inline juce::AudioParameterInt* getMonoBandsParam() { return monoBands; }
+    // Percentage of the block deadline, 0 when the governor is off
+    inline juce::AudioParameterInt* getCpuBudgetParam() { return cpuBudget; }
+
+    inline juce::AudioParameterBool* getTapParam() { return tapParam; }
+    inline juce::AudioParameterBool* getSvfParam(int split) {
+        return svfParams[split];
+    }
+    // Seconds the splits of a new program fade in over the old ones
+    inline juce::AudioParameterFloat* getMorphParam() { return morphTime; }
+
+    inline const PresetBank& getPrograms() const { return programs; }
+    // Copies the current splits into a program, message thread
+    void storeProgram(int index);
+    // Splits an audio file next to it, one file per band, in the background.
+    // Message thread.
+    void splitFile(const juce::File& input);
+    // Shared memory object the bands are exported to while the tap is on
+    inline const std::string& getTapName() const { return tapName; }
+
+    // Load and level the processing runs at, for the editor
+    inline const LoadGovernor& getGovernor() const { return governor; }
+
+    // Plugins hosted on the bands, changed from the message thread
+    inline BandChains& getChains() { return chains; }
+
+    // Group delay of a band at the centre of its range, in samples
+    inline float getBandGroupDelay(int band) const {
+        return current.load()->getBandGroupDelay(band);
+    }
+    // Instruction set the filters run with on this machine
+    inline const char* getKernelName() const {
+        return current.load()->getKernelName();
+    }
 
    private:
     juce::AudioProcessor::BusesProperties createProperties();
 
-    void processMono(juce::AudioBuffer<float>& buffer);
-    void processStereo(juce::AudioBuffer<float>& buffer);
+    // Hands the parameters, or the program that is being switched to, over
+    // to the engine
+    void updateEngine();
+    // Takes the governor's level over, fading the steps that restart the
+    // filters through the other engine
+    void followGovernor(int samples);
+    // Sets the engine up from the parameters, or from the splits of program
+    // when it isn't null, at a governor level
+    void applyParameters(SplitterEngine& engine, const Program* program,
+                         int level) const;
+    // Switches the splits to a program on the audio thread, fading the old
+    // ones out when the morph is on or the band count changes
+    void startProgram(const Program* program, int samples);
+    // Message thread, frees the replaced programs the audio thread is done
+    // with
+    void reclaimPrograms();
+    // Hands the parameters to the other engine, started from silence, and
+    // fades the current one out over length samples. False when the morph
+    // buffer is too short for the block.
+    bool startMorph(int length, int samples);
+    // Runs the fading engine into the morph buffer, then crossfades the
+    // bands with equal power
+    void morphBands(float* const* outputs, int n, int channels,
+                    const float* const* input, int samples);
+    // Frequency a split parameter holds once set to f
+    float getParamFrequency(int split, float f) const;
+    // Designs the splits ahead of the rate and type switches to come, so
+    // that the audio thread only copies coefficients
+    void prepareDesigns(double sampleRate);
+    // Everything processBlock does, sets splitSeconds
+    void processBands(juce::AudioBuffer<float>& buffer);
+    // Reports the latency and opens or closes the tap on the message thread
+    // when they change
+    void handleAsyncUpdate() override;
+
+    // Finds where each band's bus lives in the process buffer
+    void updateBandChannels();
+    // Places the bands one after the other in the main output, as pairs
+    // when they all fit and as one mono channel each otherwise. Returns the
+    // channel count the bands get.
+    int packBands(int n, int channels);
+    static juce::StringArray createTypeNames();
 
-    int lastBands = 0;
     // We have (bands - 1) splits
     juce::AudioParameterInt* bands;
     juce::AudioParameterChoice* type;
+    juce::AudioParameterBool* align;
+    juce::AudioParameterChoice* modSource;
+    juce::AudioParameterFloat* modRate;
+    juce::AudioParameterFloat* modDepth;
+    juce::AudioParameterInt* firBudget;
+    juce::AudioParameterBool* recombine;
+    juce::AudioParameterChoice* stereoMode;
+    juce::AudioParameterInt* monoBands;
+    juce::AudioParameterInt* cpuBudget;
+    juce::AudioParameterBool* tapParam;
+    juce::AudioParameterFloat* morphTime;
     std::array<juce::AudioParameterFloat*, MAX_BANDS - 1> bandParams;
-
-    BiquadFilter filters[(MAX_BANDS - 1) * 2] = {};
-
-    float hp_states[STATE_BLK * MAX_BANDS * 2] = {};
-    float lp_states[STATE_BLK * MAX_BANDS * 2] = {};
+    std::array<juce::AudioParameterBool*, MAX_BANDS - 1> modParams;
+    std::array<juce::AudioParameterBool*, MAX_BANDS - 1> svfParams;
+    std::array<juce::AudioParameterFloat*, MAX_BANDS> gainParams;
+    std::array<juce::AudioParameterBool*, MAX_BANDS> muteParams;
+    std::array<juce::AudioParameterBool*, MAX_BANDS> soloParams;
+
+    // First channel of each band's output bus, -1 if the bus is disabled
+    int bandChannels[MAX_BANDS] = {};
+    int bandChannelCounts[MAX_BANDS] = {};
+    // Channels of the main output when it holds every band, 0 with one bus
+    // per band
+    int packedChannels = 0;
+
+    // The engine that follows the parameters and the one a morph fades out,
+    // they trade places when a morph starts
+    SplitterEngine engines[2];
+    std::atomic<SplitterEngine*> current{&engines[0]};
+    SplitterEngine* fading = &engines[1];
+    int morphLength = 0, morphPosition = 0;
+    // Bands of the fading engine, then the gains of both engines
+    juce::AudioBuffer<float> morphBuffer;
+
+    PresetBank programs;
+    // Handed from setCurrentProgram to the audio thread, which runs its
+    // splits until the parameters were all set to it
+    std::atomic<const Program*> pendingProgram{nullptr},
+        settledProgram{nullptr};
+    // Only written by the audio thread, read by reclaimPrograms
+    std::atomic<const Program*> heldProgram{nullptr};
+    // Blocks the audio thread finished, programs it took before one ended
+    // are in heldProgram
+    std::atomic<unsigned int> blockEpoch{0};
+    // Sample rates the host prepared the plugin at, latest first, 0 past
+    // the last one
+    std::array<double, PREPARED_RATES> preparedRates = {};
+    BandChains chains;
+    LoadGovernor governor;
+    // Time the split of the last block took, what the governor measures
+    double splitSeconds = 0;
+    // Level the engine was set up at, behind the governor's while a morph
+    // holds a step back
+    int engineLevel = GOVERNOR_FULL;
+    BandTap tap;
+    // Files being split, one at a time
+    juce::ThreadPool fileJobs{1};
+    const std::string tapName;
+    // What the audio thread last saw of the tap parameter
+    std::atomic<bool> tapWanted{false};
+    // Latency the audio thread last saw, the host is told from the message
+    // thread
+    std::atomic<int> wantedLatency{0};
+    // Bands summed back into the main output are computed in there
+    juce::AudioBuffer<float> recombineBuffer;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BandSplitterAudioProcessor)
 };
@@ -0,0 +1,87 @@
+#include "PresetBank.hpp"
+
+#include <algorithm>
+
+// Splits past the band count keep the defaults so that adding bands later
+// puts them somewhere sensible
+static const Program FACTORY[FACTORY_PROGRAMS] = {
+    {"Default", 3, LR4, {100, 400, 1400, 2900, 5100, 7900, 11400}, {}},
+    {"Bass split", 2, LR4, {120, 400, 1400, 2900, 5100, 7900, 11400}, {}},
+    {"Three way", 3, LR4, {250, 2500, 1400, 2900, 5100, 7900, 11400}, {}},
+    {"Mastering four", 4, LR4, {120, 1000, 6000, 2900, 5100, 7900, 11400},
+     {}},
+    {"Steep five", 5, BUTTERWORTH8, {80, 300, 1200, 5000, 5100, 7900, 11400},
+     {}},
+    {"Eight bands", 8, LR4, {100, 400, 1400, 2900, 5100, 7900, 11400}, {}},
+    // Low splits at high sample rates keep their precision as state
+    // variable filters
+    {"Sub and bass",
+     3,
+     LR4,
+     {40, 120, 1400, 2900, 5100, 7900, 11400},
+     {true, true}},
+    {"Allpass three way",
+     3,
+     ALLPASS3,
+     {200, 2000, 1400, 2900, 5100, 7900, 11400},
+     {}}};
+
+PresetBank::PresetBank() {
+    for (int i = 0; i < PROGRAMS; i++) {
+        Program program = FACTORY[0];
+        if (i < FACTORY_PROGRAMS)
+            program = FACTORY[i];
+        else
+            program.name = "User " + std::to_string(i - FACTORY_PROGRAMS + 1);
+        store(i, program);
+    }
+}
+
+const Program* PresetBank::getProgram(int index) const {
+    if (index < 0 || index >= PROGRAMS) return nullptr;
+    return programs[index].load(std::memory_order_acquire);
+}
+
+void PresetBank::store(int index, const Program& program) {
+    if (index < 0 || index >= PROGRAMS) return;
+    const std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<const Program> previous = std::move(published[index]);
+    published[index] = std::make_unique<const Program>(program);
+    programs[index].store(published[index].get(), std::memory_order_release);
+    if (previous != nullptr)
+        retired.push_back({std::move(previous), false, 0});
+}
+
+void PresetBank::rename(int index, const std::string& name) {
+    const Program* program = getProgram(index);
+    if (program == nullptr) return;
+    Program renamed = *program;
+    renamed.name = name;
+    store(index, renamed);
+}
+
+const Program* PresetBank::select(int index) {
+    const Program* program = getProgram(index);
+    if (program != nullptr) selected = index;
+    return program;
+}
+
+void PresetBank::reclaim(unsigned int epoch,
+                         std::initializer_list<const Program*> held) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    auto freed = std::remove_if(
+        retired.begin(), retired.end(), [&](Retired& r) {
+            if (std::find(held.begin(), held.end(), r.program.get()) !=
+                held.end()) {
+                r.stamped = false;
+                return false;
+            }
+            if (!r.stamped) {
+                r.stamped = true;
+                r.epoch = epoch;
+                return false;
+            }
+            return epoch != r.epoch;
+        });
+    retired.erase(freed, retired.end());
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "SplitterEngine.hpp"
+
+// Factory programs come first and the user ones after them
+constexpr int FACTORY_PROGRAMS = 8;
+constexpr int USER_PROGRAMS = 8;
+constexpr int PROGRAMS = FACTORY_PROGRAMS + USER_PROGRAMS;
+
+// Longest crossfade between the splits of two programs
+constexpr double MAX_MORPH_SECONDS = 10;
+
+// Split configuration a program switches to, the rest of the parameters
+// stay as they are
+struct Program {
+    std::string name;
+    int bands;
+    enum SplitType type;
+    float frequencies[MAX_BANDS - 1];
+    bool svf[MAX_BANDS - 1];
+};
+
+// Programs of a plugin instance without any JUCE dependency. Programs are
+// immutable once published: storing or renaming one publishes a copy and
+// retires the older one, which reclaim frees once no reader can hold it, so
+// the audio thread can hold on to any program it was handed.
+class PresetBank {
+   public:
+    PresetBank();
+
+    // Any thread, null past the last program
+    const Program* getProgram(int index) const;
+    inline int getSelected() const { return selected.load(); }
+
+    // Message thread, publishes a copy of program at index
+    void store(int index, const Program& program);
+    void rename(int index, const std::string& name);
+    // Selects the program at index, returns it or null when out of range
+    const Program* select(int index);
+    // Message thread, frees the retired programs none of held points to.
+    // epoch is the count of blocks the audio thread finished, read before
+    // held: a program is freed on the first call after one where it wasn't
+    // held and that saw an older epoch, since a block then ended after the
+    // audio thread could have last taken it. Programs getProgram returned
+    // stay valid until then.
+    void reclaim(unsigned int epoch,
+                 std::initializer_list<const Program*> held);
+
+   private:
+    std::atomic<const Program*> programs[PROGRAMS] = {};
+    std::atomic<int> selected{0};
+
+    std::mutex mutex;
+    std::unique_ptr<const Program> published[PROGRAMS];
+    struct Retired {
+        std::unique_ptr<const Program> program;
+        // Epoch of the first call to reclaim that found it unheld
+        bool stamped;
+        unsigned int epoch;
+    };
+    std::vector<Retired> retired;
+};
@@ -8,7 +8,7 @@ SelectorComponent::SelectorComponent(juce::AudioParameterChoice* param)
 
     this->label.setJustificationType(juce::Justification::centred);
 
-    this->comboBox.setLookAndFeel(&lf);
+    this->comboBox.setLookAndFeel(&lf.get());
     this->comboBox.setColour(juce::ComboBox::buttonColourId,
                              juce::Colours::grey.brighter());
     this->comboBox.setColour(juce::ComboBox::backgroundColourId,
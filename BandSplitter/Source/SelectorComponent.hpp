@@ -36,7 +36,7 @@ class SelectorComponent : public juce::Component {
     juce::ComboBox comboBox;
     juce::Label label;
 
-    Looknfeel lf;
+    juce::SharedResourcePointer<Looknfeel> lf;
 
     SelectorListener listener;
 };
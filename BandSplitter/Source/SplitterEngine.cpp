@@ -0,0 +1,915 @@
+#include "SplitterEngine.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+// Ring size of the padding lines, a power of two over the longest padding
+constexpr int PAD_SIZE = MAX_FIR_LATENCY * 2;
+
+#define GET_STATE_BLOCK(ptr, BLK_SIZE, blk, filter, loops) \
+    ((ptr) + ((blk) * (BLK_SIZE) + (filter) * (2 * (loops) + 2)))
+
+SplitterEngine::SplitterEngine()
+    : kernel(&getDspKernel()), designs(DesignCache::acquire()) {
+    std::copy(DEFAULT_SPLIT_FREQUENCIES,
+              DEFAULT_SPLIT_FREQUENCIES + MAX_BANDS - 1, this->frequencies);
+    for (int i = 0; i < MAX_BANDS; i++) {
+        this->gains[i] = {
+            .gain = 1, .target = 1, .step = 0, .remaining = 0, .muted = false};
+        this->bandGains[i] = 1;
+    }
+}
+
+void SplitterEngine::prepare(double sampleRate) {
+    this->sampleRate = sampleRate;
+
+    // Alignment lines are only allocated here, the audio thread reuses them
+    int size = 1;
+    while (size < sampleRate * MAX_ALIGN_SECONDS + 4) size <<= 1;
+    if (size != delaySize) {
+        delaySize = size;
+        delayLines.reset((float*)std::calloc(
+            (size_t)size * MAX_BANDS * MAX_CHANNELS, sizeof(float)));
+    }
+    if (firHistory == nullptr) {
+        firHistory.reset((float*)std::calloc(FIR_HISTORY_SIZE, sizeof(float)));
+        firScratch.reset(
+            (float*)std::calloc(FIR_HISTORY + FIR_CHUNK, sizeof(float)));
+        firTaps.reset((float*)std::calloc(
+            (size_t)MAX_FIR_TAPS * (MAX_BANDS - 1), sizeof(float)));
+        for (int i = 0; i < MAX_BANDS - 1; i++)
+            splits[i].fir = firTaps.get() + i * MAX_FIR_TAPS;
+        lp_states.reset((float*)std::calloc(STATES_SIZE, sizeof(float)));
+        hp_states.reset((float*)std::calloc(STATES_SIZE, sizeof(float)));
+        padLines.reset((float*)std::calloc(
+            (size_t)PAD_SIZE * MAX_BANDS * MAX_CHANNELS, sizeof(float)));
+    }
+
+    // The designs are known before the first block, so is the latency
+    updateSplits(true);
+    reset();
+}
+
+void SplitterEngine::prepareDesigns(double sampleRate, enum SplitType type,
+                                    const float* frequencies) {
+    if (frequencies == nullptr) frequencies = this->frequencies;
+    // Every split, the band count can change without a prepare
+    for (int i = 0; i < MAX_BANDS - 1; i++) {
+        const IirDesign::Key key = {
+            .type = type, .sampleRate = sampleRate, .f = frequencies[i]};
+        if (designs->findIir(key) == nullptr) designs->publishIir(key);
+    }
+}
+
+void SplitterEngine::reset() {
+    resetStates();
+    delayPos = 0;
+    aligning = false;
+    padding = padPos = 0;
+
+    modRemaining = 0;
+    modElapsed = 0;
+    lfoPhase = 0;
+    envelope = envelopePeak = 0;
+}
+
+void SplitterEngine::setBands(int n) {
+    this->bands = std::clamp(n, 1, MAX_BANDS);
+}
+
+void SplitterEngine::setSplitType(enum SplitType type) { this->type = type; }
+
+void SplitterEngine::setSplitFrequency(int split, float f) {
+    this->frequencies[split] = f;
+}
+
+void SplitterEngine::addSplitEvent(int offset, int split, float f) {
+    if (eventCount == MAX_SPLIT_EVENTS) return;
+    offset = std::max(offset, 0);
+    int i = eventCount++;
+    for (; i > 0 && events[i - 1].offset > offset; i--)
+        events[i] = events[i - 1];
+    events[i] = {.offset = offset, .split = split, .f = f};
+}
+
+void SplitterEngine::setBandGain(int band, float gain) {
+    this->bandGains[band] = gain;
+}
+
+void SplitterEngine::setBandMute(int band, bool mute) {
+    this->mutes[band] = mute;
+}
+
+void SplitterEngine::setBandSolo(int band, bool solo) {
+    this->solos[band] = solo;
+}
+
+void SplitterEngine::setAlignment(bool enabled) { this->align = enabled; }
+
+void SplitterEngine::setIdleDetection(bool enabled) {
+    this->idleDetection = enabled;
+}
+
+void SplitterEngine::setBitExact(bool enabled) { this->bitExact = enabled; }
+
+void SplitterEngine::setModulation(enum ModSource source, float rate,
+                                   float depth) {
+    this->modSource = source;
+    this->modRate = rate;
+    this->modDepth = depth;
+}
+
+void SplitterEngine::setSplitModulation(int split, bool enabled) {
+    this->splitModulations[split] = enabled;
+}
+
+void SplitterEngine::setSplitTopology(int split,
+                                      enum SplitTopology topology) {
+    this->topologies[split] = topology;
+}
+
+void SplitterEngine::setFirBudget(int taps) {
+    this->firBudget = std::clamp(taps, 0, MAX_FIR_BUDGET);
+}
+
+void SplitterEngine::setPaddingBudget(int taps, bool modulation) {
+    this->paddingBudget = std::clamp(taps, 0, MAX_FIR_BUDGET);
+    this->paddingModulation = modulation;
+}
+
+void SplitterEngine::setStereoMode(enum StereoMode mode) {
+    this->stereoMode = mode;
+}
+
+void SplitterEngine::setMonoBands(int n) {
+    this->monoBands = std::clamp(n, 0, MAX_BANDS);
+}
+
+double SplitterEngine::getTailLengthSeconds() const {
+    float f = this->frequencies[0];
+    for (int i = 1; i < bands - 1; i++) f = std::min(f, frequencies[i]);
+    return getTailLengthSeconds(type, f) + getLatencySamples() / sampleRate;
+}
+
+double SplitterEngine::getTailLengthSeconds(enum SplitType type,
+                                            float lowest) {
+    // The slowest pole pair of the design sets how long the splits ring
+    return TAIL_TIME_CONSTANTS / (getSlowestDecay(type) * 2 * M_PI * lowest);
+}
+
+std::complex<double> SplitterEngine::getBandResponse(int band,
+                                                     float f) const {
+    const double omega = 2 * M_PI * f / designRate;
+    std::complex<double> response = gains[band].target;
+    for (int i = 0; i < bands - 1; i++) {
+        const Split& split = splits[i];
+        if (split.taps > 0) {
+            std::complex<double> lowpass = 0;
+            for (int k = 0; k < split.taps; k++)
+                lowpass += (double)split.fir[k] * std::polar(1.0, -omega * k);
+            const std::complex<double> delay =
+                std::polar(1.0, -omega * ((split.taps - 1) / 2));
+            response *= band <= i ? lowpass : delay - lowpass;
+            continue;
+        }
+        const struct BiquadFilterCoefficients* c =
+            band <= i ? split.lp : split.hp;
+        for (std::size_t k = 0; k < split.sections; k++)
+            response *= BiquadFilter::getResponse(c[k], omega);
+    }
+    return response;
+}
+
+double SplitterEngine::getReconstructionError(float f) const {
+    std::complex<double> sum = 0;
+    for (int j = 0; j < bands; j++) sum += getBandResponse(j, f);
+    return 20 * std::log10(std::abs(sum));
+}
+
+void SplitterEngine::updateBandGains(float* const* outputs) {
+    const int n = bands;
+    bool solo = false;
+    for (int j = 0; j < n; j++) solo |= solos[j];
+
+    const int rampLength = std::max(1, (int)(sampleRate * GAIN_RAMP_SECONDS));
+    for (int j = 0; j < n; j++) {
+        GainRamp& g = gains[j];
+
+        const bool mute = mutes[j] || (solo && !solos[j]);
+        const float target = mute ? 0 : bandGains[j];
+        if (g.target != target) {
+            g.target = target;
+            g.step = (target - g.gain) / rampLength;
+            g.remaining = rampLength;
+        }
+
+        // Bands that can't be heard aren't computed, nobody listens to them
+        // or they faded out completely
+        const bool connected = outputs[j * channels] != nullptr;
+        if (!connected) g.gain = 0;
+
+        active[j] = connected && (g.gain != 0 || g.target != 0);
+        if (!active[j]) {
+            // Stale states would keep the idle detection from kicking in
+            if (!g.muted) resetBandState(j);
+            g.muted = true;
+            g.remaining = 0;
+        } else if (g.muted) {
+            // Start from a clean state and fade back in
+            g.muted = false;
+            g.step = (g.target - g.gain) / rampLength;
+            g.remaining = rampLength;
+            resetBandState(j);
+        }
+    }
+}
+
+void SplitterEngine::advanceBandGains(int samples) {
+    for (int j = 0; j < bands; j++) {
+        GainRamp& g = gains[j];
+        if (g.remaining == 0) continue;
+
+        const int ramp = std::min(g.remaining, samples);
+        g.remaining -= ramp;
+        g.gain = g.remaining == 0 ? g.target : g.gain + g.step * ramp;
+    }
+}
+
+void SplitterEngine::applyBandGain(float* data, int samples,
+                                   int band) const {
+    const GainRamp& g = gains[band];
+    const int ramp = std::min(g.remaining, samples);
+    float gain = g.gain;
+    for (int i = 0; i < ramp; i++) {
+        data[i] *= gain;
+        gain += g.step;
+    }
+
+    if (g.target == 1) return;
+    for (int i = ramp; i < samples; i++) data[i] *= g.target;
+}
+
+void SplitterEngine::resetBandState(int band) {
+    std::memset(lp_states.get() + band * channels * STATE_BLK, 0,
+                channels * STATE_BLK * sizeof(float));
+    if (band > 0)
+        std::memset(hp_states.get() + (band - 1) * channels * STATE_BLK, 0,
+                    channels * STATE_BLK * sizeof(float));
+
+    const size_t bandHistory = (size_t)FIR_HISTORY * (MAX_BANDS - 1) *
+                               MAX_CHANNELS;
+    if (firUsed)
+        std::fill_n(firHistory.get() + band * bandHistory, bandHistory, 0);
+}
+
+void SplitterEngine::resetBandChannel(int band, int c) {
+    std::memset(lp_states.get() + (band * channels + c) * STATE_BLK, 0,
+                STATE_BLK * sizeof(float));
+    if (band > 0)
+        std::memset(
+            hp_states.get() + ((band - 1) * channels + c) * STATE_BLK, 0,
+            STATE_BLK * sizeof(float));
+
+    const size_t channelHistory = (size_t)FIR_HISTORY * (MAX_BANDS - 1);
+    if (firUsed)
+        std::fill_n(firHistory.get() +
+                        (size_t)(band * MAX_CHANNELS + c) * channelHistory,
+                    channelHistory, 0);
+}
+
+void SplitterEngine::resetSplitState(int split) {
+    for (int b = 0; b < MAX_BANDS * MAX_CHANNELS; b++) {
+        std::fill_n(GET_STATE_BLOCK(lp_states.get(), STATE_BLK, b, split,
+                                    MAX_SECTIONS),
+                    2 * MAX_SECTIONS + 2, 0.f);
+        std::fill_n(GET_STATE_BLOCK(hp_states.get(), STATE_BLK, b, split,
+                                    MAX_SECTIONS),
+                    2 * MAX_SECTIONS + 2, 0.f);
+    }
+}
+
+void SplitterEngine::resetStates() {
+    // Nothing to clear before the first prepare
+    if (lp_states == nullptr) return;
+    std::memset(lp_states.get(), 0, STATES_SIZE * sizeof(float));
+    std::memset(hp_states.get(), 0, STATES_SIZE * sizeof(float));
+    if (firUsed) std::fill_n(firHistory.get(), FIR_HISTORY_SIZE, 0);
+    firUsed = false;
+}
+
+void SplitterEngine::updateSplits(bool publish) {
+    const int t = type;
+    const double rate = sampleRate;
+    if (t != designType || rate != designRate) {
+        // Designs differ in their section count, old states are meaningless
+        if (t != designType) resetStates();
+        designType = t;
+        designRate = rate;
+        for (Split& split : splits) split.f = 0;
+    }
+
+    const bool modulation = modSource != MOD_OFF;
+    bool redesigned[MAX_BANDS - 1] = {};
+    for (int i = 0; i < MAX_BANDS - 1; i++) {
+        Split& split = splits[i];
+        const float f = frequencies[i];
+        const bool modulated =
+            modulation && splitModulations[i] && i < bands - 1;
+        if (split.f == f && split.modulated == modulated &&
+            split.topology == topologies[i])
+            continue;
+        // Integrator states mean nothing to a direct form
+        if (split.topology != topologies[i]) {
+            split.topology = topologies[i];
+            resetSplitState(i);
+        }
+        split.f = f;
+        loadIirDesign(i, publish);
+        redesigned[i] = true;
+
+        // Modulated splits are moved back around their new centre at once
+        split.modulated = false;
+        if (modulated) modRemaining = 0;
+    }
+    updateFirSplits(redesigned, publish);
+}
+
+void SplitterEngine::loadIirDesign(int i, bool publish) {
+    Split& split = splits[i];
+    const IirDesign::Key key = {
+        .type = (SplitType)designType, .sampleRate = designRate, .f = split.f};
+    const IirDesign* design = designs->findIir(key);
+    if (design == nullptr && publish) design = designs->publishIir(key);
+    if (design == nullptr) {
+        split.sections = designSplit(key.type, key.f, key.sampleRate,
+                                     split.lp, split.hp, split.branches);
+    } else {
+        split.sections = design->sections;
+        std::copy(design->lp, design->lp + MAX_SECTIONS, split.lp);
+        std::copy(design->hp, design->hp + MAX_SECTIONS, split.hp);
+        std::copy(design->branches, design->branches + 2, split.branches);
+    }
+    // One tan away from the frequency, not worth a trip to the cache. The
+    // cascades above still serve the analysis.
+    if (split.topology == TOPOLOGY_SVF)
+        designSplitSvf(key.type, key.f, key.sampleRate, split.svfLp,
+                       split.svfHp);
+}
+
+void SplitterEngine::loadFirDesign(int i, int taps, bool publish) {
+    Split& split = splits[i];
+    const FirDesign::Key key = {
+        .sampleRate = designRate, .f = split.f, .taps = taps};
+    const FirDesign* design = designs->findFir(key);
+    if (design == nullptr && publish) design = designs->publishFir(key);
+    if (design == nullptr)
+        designFirSplit(key.f, key.sampleRate, split.fir, taps);
+    else
+        std::copy(design->fir, design->fir + taps, split.fir);
+}
+
+int SplitterEngine::chooseFirSplits(int budget, bool modulation,
+                                    int* taps) const {
+    // The highest splits go first, modulated ones stay IIR as they are
+    // redesigned every MOD_BLOCK samples
+    int order[MAX_BANDS - 1], count = 0;
+    for (int i = 0; i < bands - 1; i++) {
+        if (modulation && splitModulations[i]) continue;
+        int k = count++;
+        for (; k > 0 && splits[order[k - 1]].f < splits[i].f; k--)
+            order[k] = order[k - 1];
+        order[k] = i;
+    }
+
+    int delay = 0;
+    for (int k = 0; k < count && firHistory != nullptr; k++) {
+        const int length = getFirSplitTaps(splits[order[k]].f, designRate);
+        if (length == 0 || length > budget) break;
+        taps[order[k]] = length;
+        budget -= length;
+        delay += (length - 1) / 2;
+    }
+    return delay;
+}
+
+void SplitterEngine::updateFirSplits(const bool* redesigned, bool publish) {
+    int taps[MAX_BANDS - 1] = {}, padded[MAX_BANDS - 1] = {};
+    latency = chooseFirSplits(firBudget, modSource != MOD_OFF, taps);
+    paddedLatency = paddingBudget > 0 ? chooseFirSplits(paddingBudget,
+                                                        paddingModulation,
+                                                        padded)
+                                      : 0;
+
+    bool changed = false, switched = false;
+    for (int i = 0; i < MAX_BANDS - 1; i++) {
+        Split& split = splits[i];
+        if (taps[i] > 0 && (taps[i] != split.taps || redesigned[i]))
+            loadFirDesign(i, taps[i], publish);
+        changed |= redesigned[i] || taps[i] != split.taps;
+        switched |= (taps[i] > 0) != (split.taps > 0);
+        split.taps = taps[i];
+    }
+
+    // IIR states mean nothing to an FIR and the other way round
+    if (switched) resetStates();
+    if (changed || bands != delayBands) updateGroupDelays();
+}
+
+void SplitterEngine::applySplitEvent(int i, float f) {
+    frequencies[i] = f;
+    Split& split = splits[i];
+    if (split.f == f) return;
+    split.f = f;
+    loadIirDesign(i, false);
+    // Keeps its length, and the latency, until the end of the block
+    if (split.taps > 0) loadFirDesign(i, split.taps, false);
+
+    // Same as in updateSplits, the modulation restarts around the new centre
+    if (split.modulated) {
+        split.modulated = false;
+        modRemaining = 0;
+    }
+}
+
+void SplitterEngine::updateModulation() {
+    const float rate = designRate;
+    const int elapsed = modElapsed;
+    modElapsed = 0;
+
+    float octaves;
+    if (modSource == MOD_LFO) {
+        octaves = modDepth * std::sin(2 * M_PI * lfoPhase);
+        lfoPhase += modRate * elapsed / rate;
+        lfoPhase -= std::floor(lfoPhase);
+    } else {
+        // Peak follower over the samples since the last update, the
+        // splits rise with the level
+        const float seconds = envelopePeak > envelope
+                                  ? ENVELOPE_ATTACK_SECONDS
+                                  : ENVELOPE_RELEASE_SECONDS;
+        const float a = std::exp(-elapsed / (seconds * rate));
+        envelope = envelopePeak + a * (envelope - envelopePeak);
+        envelopePeak = 0;
+        const float level =
+            envelope > 0 ? std::max(20 * std::log10(envelope),
+                                    ENVELOPE_FLOOR_DB)
+                         : ENVELOPE_FLOOR_DB;
+        octaves = modDepth * (1 - level / ENVELOPE_FLOOR_DB);
+    }
+
+    const float shift = std::exp2(octaves);
+    for (int i = 0; i < bands - 1; i++) {
+        if (!splitModulations[i]) continue;
+        Split& split = splits[i];
+        const float k = fastPrewarp(std::max(split.f * shift, 10.f), rate);
+        // The analysis reads the cascades of the base frequency of state
+        // variable splits, only what runs is moved
+        if (split.topology == TOPOLOGY_SVF)
+            designSplitSvfWarped((SplitType)designType, k, split.svfLp,
+                                 split.svfHp);
+        else
+            designSplitWarped((SplitType)designType, k, split.lp, split.hp,
+                              split.branches);
+        split.modulated = true;
+    }
+}
+
+void SplitterEngine::updateGroupDelays() {
+    const int n = bands;
+    delayBands = n;
+
+    float delays[MAX_BANDS] = {}, slowest = 0;
+    for (int j = 0; j < n; j++) {
+        // Measured at the geometric centre of the band
+        const double low = j == 0 ? 20 : splits[j - 1].f;
+        const double high = j == n - 1 ? 20000 : splits[j].f;
+        const double omega = 2 * M_PI * std::sqrt(low * high) / designRate;
+
+        // Band j goes through the lowpass of the splits above it and the
+        // highpass of the ones below
+        double delay = 0;
+        for (int i = 0; i < n - 1; i++) {
+            const Split& split = splits[i];
+            if (split.taps > 0) {
+                delay += (split.taps - 1) / 2;
+                continue;
+            }
+            const struct BiquadFilterCoefficients* c =
+                j <= i ? split.lp : split.hp;
+            for (std::size_t k = 0; k < split.sections; k++)
+                delay += BiquadFilter::getGroupDelay(c[k], omega);
+        }
+        delays[j] = (float)delay;
+        slowest = std::max(slowest, delays[j]);
+    }
+
+    // At least one sample of delay keeps the interpolation causal
+    const float longest = std::max(1, delaySize - 3);
+    for (int j = 0; j < n; j++) {
+        groupDelays[j] = delays[j] + padding;
+        alignTargets[j] = std::min(1 + slowest - delays[j], longest);
+    }
+}
+
+bool SplitterEngine::isSilent(const float* const* inputs, int samples) const {
+    for (int c = 0; c < channels; c++) {
+        for (int i = 0; i < samples; i++)
+            if (std::abs(inputs[c][i]) > SILENCE_LEVEL) return false;
+    }
+    return true;
+}
+
+bool SplitterEngine::statesSettled() const {
+    float peak = 0;
+    for (size_t i = 0; i < STATES_SIZE; i++) {
+        peak = std::max(peak, std::abs(lp_states[i]));
+        peak = std::max(peak, std::abs(hp_states[i]));
+    }
+    for (size_t i = 0; firUsed && i < FIR_HISTORY_SIZE; i++)
+        peak = std::max(peak, std::abs(firHistory[i]));
+    return peak <= SILENCE_LEVEL;
+}
+
+#define BAND(j, c) outputs[(j) * channels + (c)]
+
+void SplitterEngine::alignBands(float* const* outputs, int samples) {
+    if (delaySize == 0) return;
+
+    if (!align) {
+        aligning = false;
+        return;
+    }
+    if (!aligning) {
+        // Old contents would leak into the bands, start over from silence
+        aligning = true;
+        std::fill_n(delayLines.get(),
+                    (size_t)delaySize * MAX_BANDS * MAX_CHANNELS, 0);
+        std::copy(alignTargets, alignTargets + MAX_BANDS, alignDelays);
+    }
+
+    for (int j = 0; j < bands; j++) {
+        for (int c = 0; c < channels && active[j]; c++) {
+            float* line =
+                delayLines.get() + (size_t)(j * MAX_CHANNELS + c) * delaySize;
+            alignBand(BAND(j, c), samples, line, alignDelays[j],
+                      alignTargets[j]);
+        }
+        alignDelays[j] = alignTargets[j];
+    }
+    delayPos = (delayPos + samples) & (delaySize - 1);
+}
+
+void SplitterEngine::alignBand(float* data, int samples, float* line,
+                               float from, float to) const {
+    const int mask = delaySize - 1;
+    const float step = (to - from) / samples;
+    float d = from;
+    for (int i = 0; i < samples; i++, d += step) {
+        const int w = (delayPos + i) & mask;
+        line[w] = data[i];
+
+        // Third order Lagrange interpolation over the taps d - 1 to d + 2
+        const int k = (int)d;
+        const float m = d - k;
+        const float y0 = line[(w - k + 1) & mask], y1 = line[(w - k) & mask],
+                    y2 = line[(w - k - 1) & mask],
+                    y3 = line[(w - k - 2) & mask];
+        data[i] = -m * (m - 1) * (m - 2) / 6 * y0 +
+                  (m + 1) * (m - 1) * (m - 2) / 2 * y1 -
+                  (m + 1) * m * (m - 2) / 2 * y2 +
+                  (m + 1) * m * (m - 1) / 6 * y3;
+    }
+}
+
+void SplitterEngine::padBands(float* const* outputs, int samples) {
+    const int pad = std::max(0, paddedLatency - latency);
+    if (pad != padding) {
+        // Old contents would leak into the bands, start over from silence
+        if (padding == 0)
+            std::fill_n(padLines.get(),
+                        (size_t)PAD_SIZE * MAX_BANDS * MAX_CHANNELS, 0);
+        padding = pad;
+        updateGroupDelays();
+    }
+    if (padding == 0) return;
+
+    // Silent bands go through too, their lines stay in step with the others
+    for (int j = 0; j < bands; j++) {
+        for (int c = 0; c < channels && BAND(j, c) != nullptr; c++) {
+            float* data = BAND(j, c);
+            float* line =
+                padLines.get() + (size_t)(j * MAX_CHANNELS + c) * PAD_SIZE;
+            for (int i = 0; i < samples; i++) {
+                line[(padPos + i) & (PAD_SIZE - 1)] = data[i];
+                data[i] = line[(padPos + i - padding) & (PAD_SIZE - 1)];
+            }
+        }
+    }
+    padPos = (padPos + samples) & (PAD_SIZE - 1);
+}
+
+void SplitterEngine::processChunks(float* const* outputs, int samples) {
+    const bool modulation = modSource != MOD_OFF;
+    int modBlock = SVF_MOD_BLOCK;
+    for (int i = 0; i < bands - 1; i++) {
+        if (splitModulations[i] && splits[i].topology != TOPOLOGY_SVF)
+            modBlock = MOD_BLOCK;
+    }
+    int event = 0;
+    for (int start = 0; start < samples;) {
+        for (; event < eventCount && events[event].offset <= start; event++)
+            applySplitEvent(events[event].split, events[event].f);
+        int count = samples - start;
+        if (event < eventCount)
+            count = std::min(count, events[event].offset - start);
+
+        if (!modulation) {
+            processSplits(outputs, start, count);
+            advanceBandGains(count);
+            start += count;
+            continue;
+        }
+
+        if (modRemaining == 0) {
+            updateModulation();
+            modRemaining = modBlock;
+        }
+        count = std::min(count, modRemaining);
+
+        // Active bands still hold the input until their filters ran
+        for (int j = 0; j < bands && modSource == MOD_ENVELOPE; j++) {
+            if (!active[j]) continue;
+            for (int c = 0; c < channels; c++) {
+                const float* data = BAND(j, c) + start;
+                for (int i = 0; i < count; i++)
+                    envelopePeak = std::max(envelopePeak, std::abs(data[i]));
+            }
+            break;
+        }
+
+        processSplits(outputs, start, count);
+        advanceBandGains(count);
+        modRemaining -= count;
+        modElapsed += count;
+        start += count;
+    }
+
+    if (eventCount == 0) return;
+    for (; event < eventCount; event++)
+        applySplitEvent(events[event].split, events[event].f);
+    eventCount = 0;
+    updateGroupDelays();
+}
+
+void SplitterEngine::filterFir(float* data, int samples, float* history,
+                               const float* taps, int length, bool high) {
+    // The history is followed by the chunk, the FIR only looks at its last
+    // length - 1 samples
+    float* scratch = firScratch.get();
+    const float* input = scratch + FIR_HISTORY - (length - 1);
+    const int delay = (length - 1) / 2;
+    for (int start = 0; start < samples; start += FIR_CHUNK) {
+        const int count = std::min(FIR_CHUNK, samples - start);
+        float* chunk = data + start;
+        std::memcpy(scratch, history, FIR_HISTORY * sizeof(float));
+        std::memcpy(scratch + FIR_HISTORY, chunk, count * sizeof(float));
+
+        kernel->fir(taps, length, input, chunk, count);
+        if (high) {
+            for (int i = 0; i < count; i++)
+                chunk[i] = input[i + delay] - chunk[i];
+        }
+        std::memcpy(history, scratch + count, FIR_HISTORY * sizeof(float));
+    }
+}
+
+void SplitterEngine::processSplits(float* const* outputs, int start,
+                                   int samples) {
+    const int n = bands;
+    for (int i = 0; i < n - 1; i++) {
+        const Split& split = splits[i];
+
+        if (split.taps > 0) {
+            firUsed = true;
+            for (int j = 0; j < n; j++) {
+                if (!active[j]) continue;
+                for (int c = 0; c < getFilteredChannels(j); c++) {
+                    float* history =
+                        firHistory.get() +
+                        ((size_t)(j * MAX_CHANNELS + c) * (MAX_BANDS - 1) + i) *
+                            FIR_HISTORY;
+                    filterFir(BAND(j, c) + start, samples, history, split.fir,
+                              split.taps, j > i);
+                }
+            }
+            continue;
+        }
+
+        // Bands under the split go through its lowpass and the others
+        // through its highpass, each side runs as one batch of buffers
+        float* lowBuffers[MAX_LANES];
+        float* highBuffers[MAX_LANES];
+        State lowStates[MAX_LANES], highStates[MAX_LANES];
+        int lows = 0, highs = 0;
+        for (int j = 0; j < n; j++) {
+            if (!active[j]) continue;
+            // Dropped sides are left silent
+            for (int c = 0; c < getFilteredChannels(j); c++) {
+                if (j <= i) {
+                    lowBuffers[lows] = BAND(j, c) + start;
+                    lowStates[lows++] =
+                        GET_STATE_BLOCK(lp_states.get(), STATE_BLK,
+                                        j * channels + c, i, MAX_SECTIONS);
+                } else {
+                    highBuffers[highs] = BAND(j, c) + start;
+                    highStates[highs++] =
+                        GET_STATE_BLOCK(hp_states.get(), STATE_BLK,
+                                        (j - 1) * channels + c, i,
+                                        MAX_SECTIONS);
+                }
+            }
+        }
+        if (split.topology == TOPOLOGY_SVF) {
+            kernel->svf(split.svfLp, split.sections, lowBuffers, lowStates,
+                        lows, samples);
+            kernel->svf(split.svfHp, split.sections, highBuffers, highStates,
+                        highs, samples);
+            continue;
+        }
+        // A side with few buffers, mono mostly, would leave most of the
+        // registers empty and goes through in blocks of samples instead.
+        // Their rounding depends on where the blocks are cut, bit exact
+        // renders and sample accurate events keep the exact kernels.
+        const bool exact = bitExact || eventCount > 0;
+        const bool lowBlocks = !exact && lows * 2 <= kernel->width;
+        const bool highBlocks = !exact && highs * 2 <= kernel->width;
+        if (getCrossoverDesign((SplitType)designType).allpass) {
+            const AllpassKernel lowAllpass =
+                lowBlocks ? kernel->allpassBlocks : kernel->allpass;
+            const AllpassKernel highAllpass =
+                highBlocks ? kernel->allpassBlocks : kernel->allpass;
+            lowAllpass(split.branches, 1, lowBuffers, lowStates, lows,
+                       samples);
+            highAllpass(split.branches, -1, highBuffers, highStates, highs,
+                        samples);
+            continue;
+        }
+        const CascadeKernel lowCascade =
+            lowBlocks ? kernel->blocks : kernel->cascade;
+        const CascadeKernel highCascade =
+            highBlocks ? kernel->blocks : kernel->cascade;
+        lowCascade(split.lp, split.sections, lowBuffers, lowStates, lows,
+                   samples);
+        highCascade(split.hp, split.sections, highBuffers, highStates, highs,
+                    samples);
+    }
+
+    for (int j = 0; j < n; j++) {
+        if (!active[j]) continue;
+        for (int c = 0; c < getFilteredChannels(j); c++)
+            applyBandGain(BAND(j, c) + start, samples, j);
+    }
+}
+
+void SplitterEngine::copyInput(const float* const* inputs,
+                               float* const* outputs, int samples) {
+    const size_t bufSize = samples * sizeof(float);
+    if (!encoded) {
+        // A band that shares the memory of the input is processed in place
+        for (int j = 0; j < bands; j++) {
+            if (!active[j]) continue;
+            for (int c = 0; c < channels; c++)
+                if (BAND(j, c) != inputs[c])
+                    std::memcpy(BAND(j, c), inputs[c], bufSize);
+        }
+        return;
+    }
+
+    // Encoded once in the first active band, every sample is read before
+    // being written over in case it shares the input
+    int first = 0;
+    while (first < bands && !active[first]) first++;
+    if (first == bands) return;
+    float* mid = BAND(first, 0);
+    float* side = BAND(first, 1);
+    for (int i = 0; i < samples; i++) {
+        const float l = inputs[0][i], r = inputs[1][i];
+        mid[i] = .5f * (l + r);
+        side[i] = .5f * (l - r);
+    }
+    for (int j = first + 1; j < bands; j++) {
+        if (!active[j]) continue;
+        std::memcpy(BAND(j, 0), mid, bufSize);
+        if (j < sideless)
+            std::memset(BAND(j, 1), 0, bufSize);
+        else
+            std::memcpy(BAND(j, 1), side, bufSize);
+    }
+    if (first < sideless) std::memset(side, 0, bufSize);
+}
+
+void SplitterEngine::decodeBands(float* const* outputs, int samples) {
+    if (!encoded || stereoMode == STEREO_MS) return;
+    for (int j = 0; j < bands; j++) {
+        if (!active[j]) continue;
+        float* left = BAND(j, 0);
+        float* right = BAND(j, 1);
+        // Mono bands only need their mid copied
+        if (j < sideless) {
+            std::memcpy(right, left, samples * sizeof(float));
+            continue;
+        }
+        for (int i = 0; i < samples; i++) {
+            const float m = left[i], s = right[i];
+            left[i] = m + s;
+            right[i] = m - s;
+        }
+    }
+}
+
+void SplitterEngine::process(const float* const* inputs, int channels,
+                             float* const* outputs, int samples) {
+    const int n = bands;
+    const size_t bufSize = samples * sizeof(float);
+
+    if (this->channels != channels) {
+        this->channels = channels;
+        lastBands = 0;
+    }
+
+    // Nothing to compute until the input comes back
+    if (!idleDetection) {
+        idle = false;
+    } else if (isSilent(inputs, samples)) {
+        if (!idle) {
+            // Delayed bands still have to be flushed out once the filters
+            // settled
+            const bool settled = statesSettled();
+            settledSamples = settled ? settledSamples + samples : 0;
+            float flush = padding;
+            if (aligning)
+                flush += *std::max_element(alignDelays,
+                                           alignDelays + MAX_BANDS) + 3;
+            if (settled && settledSamples >= flush) {
+                idle = true;
+                aligning = false;
+                resetStates();
+            }
+        }
+        if (idle) {
+            // The splits are redesigned once the input comes back
+            for (int e = 0; e < eventCount; e++)
+                frequencies[events[e].split] = events[e].f;
+            eventCount = 0;
+            for (int j = 0; j < n; j++) {
+                for (int c = 0; c < channels; c++)
+                    if (BAND(j, c)) std::memset(BAND(j, c), 0, bufSize);
+            }
+            return;
+        }
+    } else {
+        idle = false;
+        settledSamples = 0;
+    }
+
+    // Bands are rewired, start them over from silence
+    if (lastBands != n) {
+        lastBands = n;
+        resetStates();
+    }
+    // Left/right and mid/side states don't carry over to each other
+    const bool encode =
+        channels == 2 && (stereoMode == STEREO_MS || monoBands > 0);
+    if (encoded != encode) {
+        encoded = encode;
+        resetStates();
+    }
+    // Sides coming back start from silence, dropped ones mustn't hold the
+    // idle detection back
+    const int mono = encode ? std::min(monoBands, n) : 0;
+    for (int j = std::min(mono, sideless); j < std::max(mono, sideless); j++)
+        if (encode) resetBandChannel(j, 1);
+    sideless = mono;
+
+    updateSplits(false);
+    updateBandGains(outputs);
+
+    copyInput(inputs, outputs, samples);
+    // Silent bands come last as they may share the input as well
+    for (int j = 0; j < n; j++) {
+        if (active[j] || !BAND(j, 0)) continue;
+        for (int c = 0; c < channels; c++) std::memset(BAND(j, c), 0, bufSize);
+    }
+
+    processChunks(outputs, samples);
+    alignBands(outputs, samples);
+    decodeBands(outputs, samples);
+    padBands(outputs, samples);
+
+    for (int j = 0; j < n; j++) {
+        if (active[j] && !std::isfinite(BAND(j, 0)[0])) {
+            resetStates();
+            break;
+        }
+    }
+}
@@ -0,0 +1,333 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+
+#include "BiquadFilter.hpp"
+#include "CrossoverDesign.hpp"
+#include "DesignCache.hpp"
+#include "DspKernels.hpp"
+
+constexpr int MAX_BANDS = 8;
+constexpr int MAX_CHANNELS = 2;
+static_assert(MAX_BANDS * MAX_CHANNELS <= MAX_LANES,
+              "a split has to fit in one kernel call");
+
+constexpr std::size_t STATE_BLK = (MAX_BANDS - 1) * (2 * MAX_SECTIONS + 2);
+
+// Length of the per-sample band gain ramps
+constexpr double GAIN_RAMP_SECONDS = .02;
+
+// Level (-120dB) under which inputs and filter states count as silence
+constexpr float SILENCE_LEVEL = 1e-6f;
+// Time constants of the slowest pole pair before an impulse response falls
+// under SILENCE_LEVEL (with the double poles of LR4)
+constexpr double TAIL_TIME_CONSTANTS = 17;
+
+// Longest delay the band alignment can add
+constexpr double MAX_ALIGN_SECONDS = .1;
+
+// Modulated splits are redesigned every MOD_BLOCK samples
+constexpr int MOD_BLOCK = 32;
+constexpr float ENVELOPE_ATTACK_SECONDS = .01f;
+constexpr float ENVELOPE_RELEASE_SECONDS = .2f;
+// State variable splits are cheap enough to redesign every SVF_MOD_BLOCK
+// samples, the grid uses it when every modulated split is one
+constexpr int SVF_MOD_BLOCK = 8;
+// Envelope level at which modulated splits sit at their base frequency
+constexpr float ENVELOPE_FLOOR_DB = -60;
+
+enum ModSource { MOD_OFF, MOD_LFO, MOD_ENVELOPE };
+
+// Channels the stereo bands come out as, mid/side bands hold the mid in the
+// first channel and the side in the second
+enum StereoMode { STEREO_LR, STEREO_MS };
+
+// Structure the IIR filters of a split run as, both give the same response.
+// State variable sections keep their precision at low frequencies and high
+// sample rates and are cheaper to modulate.
+enum SplitTopology { TOPOLOGY_DIRECT, TOPOLOGY_SVF };
+
+// Split frequency changes that can be queued for one process call
+constexpr int MAX_SPLIT_EVENTS = 1024;
+
+// Most taps the linear phase splits can share, per band channel
+constexpr int MAX_FIR_BUDGET = 1024;
+// Inputs a linear phase split keeps, whatever its current length
+constexpr int FIR_HISTORY = MAX_FIR_TAPS - 1;
+// Samples convolved at once
+constexpr int FIR_CHUNK = 256;
+// Longest delay the linear phase splits can add up to within the largest
+// budget, and so the longest the bands are padded with
+constexpr int MAX_FIR_LATENCY = MAX_FIR_BUDGET / 2;
+constexpr std::size_t FIR_HISTORY_SIZE =
+    (std::size_t)FIR_HISTORY * (MAX_BANDS - 1) * MAX_BANDS * MAX_CHANNELS;
+// Filter states of every band channel, for the lowpasses and the highpasses
+constexpr std::size_t STATES_SIZE = STATE_BLK * MAX_BANDS * MAX_CHANNELS;
+
+// Split frequencies of a new instance, spread on a quadratic curve
+constexpr float DEFAULT_SPLIT_FREQUENCIES[MAX_BANDS - 1] = {
+    100, 400, 1400, 2900, 5100, 7900, 11400};
+
+// The split engine without any JUCE dependency, the plugin drives it from
+// its parameters and other programs can link it directly
+class SplitterEngine {
+   public:
+    SplitterEngine();
+
+    // Allocates everything the audio thread needs and clears the states
+    void prepare(double sampleRate);
+    void reset();
+    // Publishes the designs of the current split frequencies, or of the
+    // MAX_BANDS - 1 given ones, at another sample rate or type. Switching to
+    // them later only copies coefficients. Allocates, and leaves what the
+    // engine runs untouched.
+    void prepareDesigns(double sampleRate, enum SplitType type,
+                        const float* frequencies = nullptr);
+
+    void setBands(int n);
+    void setSplitType(enum SplitType type);
+    void setSplitFrequency(int split, float f);
+    // Moves a split at a sample offset of the next process call, the block
+    // is cut there and only that split is redesigned. Offsets past the end
+    // of the block apply after its last sample, events past
+    // MAX_SPLIT_EVENTS are dropped.
+    void addSplitEvent(int offset, int split, float f);
+    // Linear gain, muted or unsoloed bands fade out and stop being computed
+    void setBandGain(int band, float gain);
+    void setBandMute(int band, bool mute);
+    void setBandSolo(int band, bool solo);
+    void setAlignment(bool enabled);
+    void setModulation(enum ModSource source, float rate, float depth);
+    void setSplitModulation(int split, bool enabled);
+    // Changing it starts the split over from silence
+    void setSplitTopology(int split, enum SplitTopology topology);
+    // Taps per sample and band channel the highest splits can spend on
+    // linear phase FIRs instead of IIR filters, 0 keeps every split IIR
+    void setFirBudget(int taps);
+    // Delays every band by what the linear phase splits would add within
+    // taps at the current frequencies, less what they take now, with the
+    // modulated splits left IIR when modulation is on. Keeps the latency a
+    // host was told about when the FIR budget is taken away, 0 turns it off.
+    void setPaddingBudget(int taps, bool modulation);
+    // Stereo inputs are split as mid and side whenever the bands come out as
+    // mid/side or some are mono. The side of the lowest n bands is dropped
+    // without ever being filtered.
+    void setStereoMode(enum StereoMode mode);
+    void setMonoBands(int n);
+    // Skipping silent blocks cuts the tails under SILENCE_LEVEL, offline
+    // renders turn it off to stay independent of the block size
+    void setIdleDetection(bool enabled);
+    // Sides with few buffers, mono mostly, run faster in blocks of samples
+    // whose rounding depends on where the blocks are cut. Off by default,
+    // renders that must not depend on the block size turn it on to keep
+    // the exact kernels.
+    void setBitExact(bool enabled);
+
+    // Splits 1 or 2 planar input channels, outputs holds the channels of
+    // every band one after the other (band j, channel c at j * channels + c)
+    // and is null for bands nobody listens to. Outputs may share the memory
+    // of the inputs.
+    void process(const float* const* inputs, int channels,
+                 float* const* outputs, int samples);
+
+    inline int getBands() const { return bands; }
+    inline enum SplitType getSplitType() const { return type; }
+    inline double getSampleRate() const { return sampleRate; }
+    inline bool isIdle() const { return idle; }
+    // Delay of the linear phase splits or of the ones the padding stands
+    // for, common to every band
+    inline int getLatencySamples() const {
+        return std::max(latency, paddedLatency);
+    }
+    // Instruction set of the filter kernels picked for this CPU
+    inline const char* getKernelName() const { return kernel->name; }
+
+    // Group delay of a band at the centre of its range, in samples
+    inline float getBandGroupDelay(int band) const {
+        return groupDelays[band];
+    }
+
+    double getTailLengthSeconds() const;
+
+    // Response of a band at frequency f with its gain target, from the
+    // designs of the last processed block. Meant for analysis while the
+    // engine isn't processing.
+    std::complex<double> getBandResponse(int band, float f) const;
+    // Deviation of the sum of the bands from a flat magnitude at f, in dB
+    double getReconstructionError(float f) const;
+    static double getTailLengthSeconds(enum SplitType type, float lowest);
+
+   private:
+    // Runs the splits over the block, cut at the split events and the
+    // modulation updates
+    void processChunks(float* const* outputs, int samples);
+    void processSplits(float* const* outputs, int start, int samples);
+
+    // Starts the gain ramps of this block, active is set to false for bands
+    // that are fully muted and whose filters can be skipped
+    void updateBandGains(float* const* outputs);
+    void advanceBandGains(int samples);
+    // Applies the gain ramp of a band after its last filter. The splits run
+    // the buffers of many bands through one kernel call, so the ramp is its
+    // own pass over the chunk while it's still in cache, and unity gains
+    // past the ramp skip it.
+    void applyBandGain(float* data, int samples, int band) const;
+    // Runs a linear phase split, the highpass side is the delayed input
+    // minus the lowpass
+    void filterFir(float* data, int samples, float* history,
+                   const float* taps, int length, bool high);
+    void resetBandState(int band);
+    // Clears the filters of one split in every band
+    void resetSplitState(int split);
+    void resetStates();
+
+    // Redesigns the splits whose frequency, type or sample rate changed,
+    // publish adds the new designs to the shared cache and allocates
+    void updateSplits(bool publish);
+    void applySplitEvent(int split, float f);
+    // Picks the splits that run as linear phase FIRs
+    void updateFirSplits(const bool* redesigned, bool publish);
+    // Gives the highest splits their taps within budget, returns the delay
+    // they add
+    int chooseFirSplits(int budget, bool modulation, int* taps) const;
+    // Copies the designs of a split at its frequency from the cache, they
+    // are computed in place when nobody published them
+    void loadIirDesign(int split, bool publish);
+    void loadFirDesign(int split, int taps, bool publish);
+    void updateGroupDelays();
+    // Moves the modulated splits around their base frequency
+    void updateModulation();
+
+    // Delays the bands so that they line up with the slowest one
+    void alignBands(float* const* outputs, int samples);
+    void alignBand(float* data, int samples, float* line, float from,
+                   float to) const;
+    // Delays every band by what the linear phase splits lack of the padded
+    // latency
+    void padBands(float* const* outputs, int samples);
+
+    // Fills the active bands with the input, as mid and side when encoded
+    void copyInput(const float* const* inputs, float* const* outputs,
+                   int samples);
+    // Turns mid/side bands back into left and right
+    void decodeBands(float* const* outputs, int samples);
+    // Clears the filters of one channel of a band
+    void resetBandChannel(int band, int c);
+    inline int getFilteredChannels(int band) const {
+        return band < sideless ? 1 : channels;
+    }
+
+    bool isSilent(const float* const* inputs, int samples) const;
+    bool statesSettled() const;
+
+    const struct DspKernel* kernel;
+    std::shared_ptr<DesignCache> designs;
+
+    double sampleRate = 44100;
+    int bands = 3, channels = 0, lastBands = 0;
+    enum SplitType type = LR4;
+    // Set once the input is silent and every filter has rung out
+    bool idleDetection = true, idle = false, bitExact = false;
+    int settledSamples = 0;
+
+    struct GainRamp {
+        float gain, target, step;
+        int remaining;
+        bool muted;
+    };
+    GainRamp gains[MAX_BANDS] = {};
+    float bandGains[MAX_BANDS];
+    bool mutes[MAX_BANDS] = {}, solos[MAX_BANDS] = {};
+    bool active[MAX_BANDS] = {};
+
+    enum StereoMode stereoMode = STEREO_LR;
+    int monoBands = 0;
+    // Whether the last block ran as mid/side, and how many of its bands had
+    // their side dropped
+    bool encoded = false;
+    int sideless = 0;
+
+    struct Split {
+        float f;
+        std::size_t sections;
+        // Set while the coefficients are away from f
+        bool modulated;
+        struct BiquadFilterCoefficients lp[MAX_SECTIONS], hp[MAX_SECTIONS];
+        // What actually runs for doubly complementary types, lp and hp are
+        // their equivalent cascades for the analysis
+        struct BiquadFilterCoefficients branches[2];
+        // What runs instead of the cascades and the branches with
+        // TOPOLOGY_SVF
+        enum SplitTopology topology;
+        struct SvfCoefficients svfLp[MAX_SECTIONS], svfHp[MAX_SECTIONS];
+        // Length of the linear phase lowpass, 0 when the split is IIR, and
+        // its MAX_FIR_TAPS in firTaps
+        int taps;
+        float* fir;
+    };
+    float frequencies[MAX_BANDS - 1] = {};
+    enum SplitTopology topologies[MAX_BANDS - 1] = {};
+    Split splits[MAX_BANDS - 1] = {};
+    int designType = -1;
+    double designRate = 0;
+    int firBudget = 0, latency = 0;
+    int paddingBudget = 0, paddedLatency = 0;
+    bool paddingModulation = false;
+
+    int delayBands = 0;
+    std::array<std::atomic<float>, MAX_BANDS> groupDelays = {};
+
+    // Buffers from calloc, their pages are only backed once written to so
+    // the features that stay off cost no memory. Everything sized for the
+    // largest layout lives in them and is allocated by prepare, which keeps
+    // the engine itself small.
+    struct FreeDeleter {
+        template <typename T>
+        void operator()(T* data) const {
+            std::free(data);
+        }
+    };
+
+    // Sorted by offset, equal offsets keep the order they came in. A member
+    // rather than a buffer from prepare, so that events queued before the
+    // first prepare are kept.
+    struct SplitEvent {
+        int offset, split;
+        float f;
+    };
+    struct SplitEvent events[MAX_SPLIT_EVENTS];
+    int eventCount = 0;
+
+    // One delay line per band channel, they all share the write position.
+    // They are cleared when the alignment starts.
+    bool align = false, aligning = false;
+    std::unique_ptr<float[], FreeDeleter> delayLines;
+    int delaySize = 0, delayPos = 0;
+    float alignDelays[MAX_BANDS] = {}, alignTargets[MAX_BANDS] = {};
+
+    // The modulation grid runs across blocks
+    enum ModSource modSource = MOD_OFF;
+    float modRate = 1, modDepth = 1;
+    bool splitModulations[MAX_BANDS - 1] = {};
+    int modRemaining = 0, modElapsed = 0;
+    double lfoPhase = 0;
+    float envelope = 0, envelopePeak = 0;
+
+    // FIR_HISTORY inputs per band channel and split, band after band. Only
+    // cleared once a split ran as an FIR.
+    std::unique_ptr<float[], FreeDeleter> firHistory;
+    bool firUsed = false;
+    std::unique_ptr<float[], FreeDeleter> firScratch, firTaps;
+
+    // One line per band channel sharing the write position, cleared
+    // whenever the padding starts
+    std::unique_ptr<float[], FreeDeleter> padLines;
+    int padding = 0, padPos = 0;
+
+    std::unique_ptr<float[], FreeDeleter> hp_states, lp_states;
+};
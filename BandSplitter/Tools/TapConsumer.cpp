@@ -0,0 +1,99 @@
+// Reads the bands a BandSplitter instance exports through its shared memory
+// tap and prints their levels twice a second
+//
+// make TapConsumer && ./BandSplitter/Builds/Library/TapConsumer [name] [s]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+
+#include "BandTapApi.h"
+
+constexpr int READ_FRAMES = 1024;
+constexpr double REPORT_SECONDS = .5;
+
+// First tap found in /dev/shm, where Linux keeps the shared memory objects
+static std::string findTap() {
+    DIR* dir = opendir("/dev/shm");
+    if (dir == nullptr) return {};
+    const char* prefix = BANDTAP_NAME_PREFIX + 1;
+    std::string found;
+    while (const dirent* entry = readdir(dir)) {
+        if (std::strncmp(entry->d_name, prefix, std::strlen(prefix)) != 0)
+            continue;
+        found = std::string("/") + entry->d_name;
+        break;
+    }
+    closedir(dir);
+    return found;
+}
+
+int main(int argc, char** argv) {
+    const std::string name = argc > 1 && *argv[1] ? argv[1] : findTap();
+    const double seconds = argc > 2 ? std::atof(argv[2]) : 10;
+    if (name.empty()) {
+        std::fprintf(stderr, "No tap found, give its name\n");
+        return 1;
+    }
+    BandTapReader* reader = bandtap_open(name.c_str());
+    if (reader == nullptr) {
+        std::fprintf(stderr, "Can't open the tap %s\n", name.c_str());
+        return 1;
+    }
+    const BandTapHeader* header = bandtap_get_header(reader);
+    std::printf("%s, %g Hz\n", name.c_str(), header->sampleRate);
+
+    std::vector<float> buffer((size_t)READ_FRAMES * BANDTAP_SLOTS);
+    float* outputs[BANDTAP_SLOTS];
+    for (int s = 0; s < BANDTAP_SLOTS; s++)
+        outputs[s] = buffer.data() + (size_t)s * READ_FRAMES;
+
+    double energy[BANDTAP_SLOTS] = {};
+    long frames = 0;
+    const auto start = std::chrono::steady_clock::now();
+    auto report = start;
+    while (std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+               .count() < seconds) {
+        const int read = bandtap_read(reader, outputs, READ_FRAMES);
+        for (int s = 0; s < BANDTAP_SLOTS; s++)
+            for (int i = 0; i < read; i++)
+                energy[s] += (double)outputs[s][i] * outputs[s][i];
+        frames += read;
+        if (read < READ_FRAMES)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+        const auto now = std::chrono::steady_clock::now();
+        if (std::chrono::duration<double>(now - report).count() <
+            REPORT_SECONDS)
+            continue;
+        report = now;
+
+        // Level of each band, its channels together
+        const int bands = (int)header->bands;
+        const int channels = std::max(1, (int)header->channels);
+        std::printf("%6ld frames, %llu lost |", frames,
+                    (unsigned long long)bandtap_get_lost(reader));
+        for (int j = 0; j < bands && j < BANDTAP_MAX_BANDS; j++) {
+            double sum = 0;
+            for (int c = 0; c < channels; c++)
+                sum += energy[j * BANDTAP_MAX_CHANNELS + c];
+            const double rms = std::sqrt(sum / std::max(1L, frames * channels));
+            std::printf(" %6.1f", 20 * std::log10(rms + 1e-9));
+        }
+        std::printf(" dB\n");
+        std::fill(energy, energy + BANDTAP_SLOTS, 0);
+        frames = 0;
+    }
+
+    bandtap_close(reader);
+    return 0;
+}